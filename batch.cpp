@@ -0,0 +1,364 @@
+#include <stdio.h>
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <unordered_map>
+#include <string>
+#include <vector>
+
+#include "chip8_core.h"
+#include "chip8_input.h"
+#include "chip8_map.h"
+#include "chip8_archive.h"
+
+// ROM bytes shared by jobs: a mapped file, a stored archive member in the archive's mapping or an inflated copy
+typedef struct
+{
+    const uint8_t *data;
+    size_t size;
+} rom_image_t;
+
+// One manifest line: ROM, keypad input script ("-" for none), instruction budget and CXNN seed
+typedef struct
+{
+    char rom[260];
+    char input[260];
+    uint64_t cycles; // instructions to emulate
+    uint32_t seed;
+    const rom_image_t *image; // NULL if the ROM could not be loaded
+
+    // results
+    bool ok;
+    uint64_t cycles_run;
+    uint32_t frames;
+    uint64_t hash; // final machine state hash
+    double wall_ms;
+} job_t;
+
+// Per worker job queue, owner takes from the front, idle workers steal from the back
+typedef struct
+{
+    std::mutex lock;
+    std::deque<uint32_t> jobs;
+} job_queue_t;
+
+// Every ROM the jobs run, loaded before the workers start and shared read-only by all of them
+typedef struct
+{
+    std::unordered_map<std::string, const rom_image_t *> images; // by ROM name, "archive/member" for archives
+    std::unordered_map<std::string, std::vector<std::string>> members; // ROM names in each loaded archive
+    std::deque<rom_image_t> storage;
+    std::deque<mapped_file_t> files;
+    std::deque<archive_t> archives; // kept open, stored members point into their mappings
+    std::deque<std::vector<uint8_t>> inflated;
+} rom_set_t;
+
+// Manifest: one "<rom> <input script|-> <cycles> [seed]" job per line, '#' starts a comment.
+// Jobs without a seed use "seed". A zip or tar as ROM runs the job for every ROM in it, and
+// "archive/member" runs one of them.
+bool loadManifest(const char *path, uint32_t seed, job_t **jobs, uint32_t *count)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        std::cout << "Manifest " << path << " invalid or does not exist!\n";
+        return false;
+    }
+
+    uint32_t capacity = 0;
+    char line[1024];
+    *jobs = NULL;
+    *count = 0;
+    while (fgets(line, sizeof line, file))
+    {
+        job_t job = {};
+        job.seed = seed;
+        if (line[0] == '#' || sscanf(line, "%259s %259s %llu %u", job.rom, job.input, (unsigned long long *)&job.cycles, &job.seed) < 3)
+            continue;
+        if (*count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 256;
+            job_t *grown = (job_t *)realloc(*jobs, capacity * sizeof *grown);
+            if (!grown)
+            {
+                std::cout << "Manifest " << path << " invalid or does not exist!\n";
+                fclose(file);
+                free(*jobs);
+                *jobs = NULL;
+                *count = 0;
+                return false;
+            }
+            *jobs = grown;
+        }
+        (*jobs)[(*count)++] = job;
+    }
+    fclose(file);
+    return true;
+}
+
+// Load every ROM in a zip or tar once, NULL if it can't be opened
+const std::vector<std::string> *loadArchive(rom_set_t *roms, const std::string &path)
+{
+    const auto found = roms->members.find(path);
+    if (found != roms->members.end())
+        return &found->second;
+    roms->archives.emplace_back();
+    archive_t *archive = &roms->archives.back();
+    if (!openArchive(archive, roms->members.emplace(path, std::vector<std::string>()).first->first.c_str()))
+        return NULL;
+
+    std::vector<std::string> *names = &roms->members[path];
+    archive_entry_t entry;
+    while (nextArchiveEntry(archive, &entry))
+    {
+        if (!isRomName(entry.name))
+            continue;
+        const uint8_t *data = readArchiveEntry(archive, &entry);
+        if (!data)
+            continue;
+        if (data == archive->buffer) // inflated, the buffer is reused by the next entry
+        {
+            roms->inflated.emplace_back(data, data + entry.size);
+            data = roms->inflated.back().data();
+        }
+        roms->storage.push_back({data, entry.size});
+        names->push_back(path + "/" + entry.name);
+        roms->images[names->back()] = &roms->storage.back();
+    }
+    return names;
+}
+
+// Resolve every job's ROM once: files are mapped, archives expand into one job per ROM they hold.
+// False (jobs untouched) if the expanded job list can't be allocated.
+bool loadRoms(rom_set_t *roms, job_t **jobs, uint32_t *count)
+{
+    std::vector<job_t> expanded;
+    for (uint32_t i = 0; i < *count; i++)
+    {
+        job_t job = (*jobs)[i];
+        const std::string name = job.rom;
+        if (isArchiveName(job.rom))
+        {
+            const std::vector<std::string> *names = loadArchive(roms, name);
+            if (!names || names->empty())
+            {
+                if (names)
+                    std::cout << "Archive " << name << " holds no ROMs\n";
+                expanded.push_back(job); // reported as a failed job
+                continue;
+            }
+            for (const std::string &member : *names)
+            {
+                snprintf(job.rom, sizeof job.rom, "%s", member.c_str());
+                job.image = roms->images[member];
+                expanded.push_back(job);
+            }
+            continue;
+        }
+
+        auto found = roms->images.find(name);
+        if (found == roms->images.end())
+        {
+            size_t split = name.find(".zip/");
+            if (split == std::string::npos)
+                split = name.find(".tar/");
+            if (split != std::string::npos && loadArchive(roms, name.substr(0, split + 4)))
+                found = roms->images.find(name);
+        }
+        if (found == roms->images.end())
+        {
+            mapped_file_t map;
+            if (mapFile(&map, job.rom))
+            {
+                roms->files.push_back(map);
+                roms->storage.push_back({map.data, map.size});
+                found = roms->images.emplace(name, &roms->storage.back()).first;
+            }
+        }
+        job.image = found != roms->images.end() ? found->second : NULL;
+        expanded.push_back(job);
+    }
+    job_t *resized = (job_t *)realloc(*jobs, (expanded.size() ? expanded.size() : 1) * sizeof *resized);
+    if (!resized)
+        return false;
+    *jobs = resized;
+    if (!expanded.empty())
+        memcpy(*jobs, expanded.data(), expanded.size() * sizeof **jobs);
+    *count = (uint32_t)expanded.size();
+    return true;
+}
+
+// Run one job to its instruction budget on its own machine
+void runJob(job_t *job, const config_t config)
+{
+    const auto start = std::chrono::steady_clock::now();
+    chip8_t chip8 = {};
+    input_script_t script = {};
+
+    if (!job->image)
+        std::cout << "ROM" << job->rom << "invalid or does not exist!\n";
+    job->ok = job->image && loadChip8(&chip8, job->image->data, job->image->size, job->rom) &&
+              (strcmp(job->input, "-") == 0 || loadInputScript(&script, job->input));
+    if (job->ok)
+    {
+        seedChip8(&chip8, job->seed);
+        const uint32_t insts = config.insts_per_second / 60 ? config.insts_per_second / 60 : 1;
+        while (job->cycles_run < job->cycles && chip8.state != QUIT)
+        {
+            applyInputScript(&script, &chip8, job->frames);
+
+            const uint64_t left = job->cycles - job->cycles_run;
+            const uint32_t count = left < insts ? (uint32_t)left : insts;
+            for (uint32_t i = 0; i < count; i++)
+                emulateInstruction(&chip8, config);
+            job->cycles_run += count;
+
+            // Only a full frame of instructions ticks the 60Hz timers
+            if (count == insts)
+            {
+                updateTimers(&chip8);
+                job->frames++;
+            }
+        }
+        job->hash = hashChip8(&chip8);
+    }
+    freeInputScript(&script);
+
+    job->wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Take next job: own queue first, then steal from the other workers
+bool nextJob(job_queue_t *queues, uint32_t workers, uint32_t self, uint32_t *job)
+{
+    for (uint32_t i = 0; i < workers; i++)
+    {
+        job_queue_t *queue = &queues[(self + i) % workers];
+        std::lock_guard<std::mutex> guard(queue->lock);
+        if (queue->jobs.empty())
+            continue;
+        if (i == 0)
+        {
+            *job = queue->jobs.front();
+            queue->jobs.pop_front();
+        }
+        else
+        {
+            *job = queue->jobs.back();
+            queue->jobs.pop_back();
+        }
+        return true;
+    }
+    return false; // No jobs are added once started, every queue empty means done
+}
+
+// Write string as a JSON string literal
+void printJsonString(FILE *out, const char *str)
+{
+    fputc('"', out);
+    for (; *str; str++)
+    {
+        if (*str == '"' || *str == '\\')
+            fputc('\\', out);
+        fputc(*str, out);
+    }
+    fputc('"', out);
+}
+
+int main(int argv, char **args)
+{
+    if (argv < 2)
+    {
+        std::cerr << "Usage " << args[0] << " <manifest> [-j threads] [--out results.jsonl] [--ips N] [--seed N]\n";
+        return 1;
+    }
+
+    // emulator options (--ips etc.) are shared with the interactive emulator
+    config_t config = {0};
+    setupEmulator(&config, argv, args);
+
+    uint32_t workers = std::thread::hardware_concurrency();
+    const char *out_path = NULL;
+    for (int i = 2; i < argv; i++)
+    {
+        if (strncmp(args[i], "-j", strlen("-j")) == 0)
+        {
+            i++;
+            workers = (uint32_t)strtol(args[i], NULL, 10);
+        }
+        if (strncmp(args[i], "--out", strlen("--out")) == 0)
+        {
+            i++;
+            out_path = args[i];
+        }
+    }
+    if (workers == 0)
+        workers = 1;
+
+    job_t *jobs;
+    uint32_t count;
+    if (!loadManifest(args[1], config.seed, &jobs, &count))
+        return 1;
+
+    // Map or unpack each distinct ROM once, every job and worker copies from the same read-only bytes
+    const auto load_start = std::chrono::steady_clock::now();
+    rom_set_t roms;
+    if (!loadRoms(&roms, &jobs, &count))
+    {
+        std::cout << "Manifest " << args[1] << " invalid or does not exist!\n";
+        free(jobs);
+        return 1;
+    }
+    std::cerr << roms.storage.size() << " ROMs loaded in "
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - load_start).count() << " ms\n";
+
+    FILE *out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out)
+    {
+        std::cout << "Could not open " << out_path << "\n";
+        return 1;
+    }
+
+    // Deal jobs out in contiguous runs, workers that finish early steal the rest
+    job_queue_t *queues = new job_queue_t[workers];
+    for (uint32_t i = 0; i < count; i++)
+        queues[(uint64_t)i * workers / count].jobs.push_back(i);
+
+    const auto start = std::chrono::steady_clock::now();
+    std::thread *threads = new std::thread[workers];
+    for (uint32_t w = 0; w < workers; w++)
+        threads[w] = std::thread([&, w]()
+                                 {
+                                     uint32_t job;
+                                     while (nextJob(queues, workers, w, &job))
+                                         runJob(&jobs[job], config); });
+    for (uint32_t w = 0; w < workers; w++)
+        threads[w].join();
+    const double wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // Results in manifest order so nightly runs diff cleanly
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const job_t *job = &jobs[i];
+        fprintf(out, "{\"job\":%u,\"rom\":", i);
+        printJsonString(out, job->rom);
+        fprintf(out, ",\"input\":");
+        printJsonString(out, job->input);
+        fprintf(out, ",\"seed\":%u,\"ok\":%s,\"cycles\":%llu,\"frames\":%u,\"hash\":\"%016llx\",\"wall_ms\":%.3f}\n",
+                job->seed, job->ok ? "true" : "false", (unsigned long long)job->cycles_run, job->frames,
+                (unsigned long long)job->hash, job->wall_ms);
+    }
+    std::cerr << count << " jobs on " << workers << " threads in " << wall_ms << " ms\n";
+
+    if (out != stdout)
+        fclose(out);
+    for (mapped_file_t &file : roms.files)
+        unmapFile(&file);
+    for (archive_t &archive : roms.archives)
+        closeArchive(&archive);
+    delete[] threads;
+    delete[] queues;
+    free(jobs);
+    return 0;
+}
@@ -0,0 +1,283 @@
+#include <stdio.h>
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <filesystem>
+
+#include "chip8_emulator.h"
+#include "chip8_opcodes.h"
+
+// Microbenchmarks, one JSON line per case: {"bench":..,"case":..,"ns":..,"iters":..}.
+// "ns" is the best of 5 runs of about 20ms each, per iteration.
+
+// Keep results alive so the compiler can't drop benchmarked work
+volatile uint64_t sink;
+
+// Best ns per call of "body" (runs "batch" iterations per call)
+template <typename F>
+double timeBest(F body, uint32_t batch, uint64_t *iters)
+{
+    double best = 1e30;
+    *iters = 0;
+    for (uint32_t run = 0; run < 5; run++)
+    {
+        uint64_t n = 0;
+        const auto start = std::chrono::steady_clock::now();
+        double elapsed;
+        do
+        {
+            body();
+            n += batch;
+            elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        } while (elapsed < 20e6);
+        best = std::min(best, elapsed / n);
+        *iters += n;
+    }
+    return best;
+}
+
+void printResult(const char *bench, const char *name, double ns, uint64_t iters)
+{
+    printf("{\"bench\":\"%s\",\"case\":\"%s\",\"ns\":%.2f,\"iters\":%llu}\n", bench, name, ns, (unsigned long long)iters);
+    fflush(stdout);
+}
+
+// One representative opcode per class (chip8_opcodes.h order), V1 = V2 = 8, I = 0x300
+const uint16_t class_samples[OP_CLASSES] = {
+    0x00E0, 0x00EE, 0x0123,
+    0x1200, 0x2200, 0x3100, 0x4100, 0x5120, 0x61AB, 0x7101,
+    0x8120, 0x8121, 0x8122, 0x8123, 0x8124, 0x8125, 0x8126, 0x8127, 0x812E, 0x8128,
+    0x9120, 0xA300, 0xB200, 0xC1FF, 0xD125,
+    0xE19E, 0xE1A1, 0xE1FF,
+    0xF002, 0xF107, 0xF10A, 0xF115, 0xF118, 0xF11E, 0xF129, 0xF133, 0xF13A, 0xFF55, 0xFF65, 0xF1FF,
+};
+
+// A machine with "opcode" at 0x200
+void setupOpcode(chip8_t *chip8, uint16_t opcode)
+{
+    const uint8_t program[] = {(uint8_t)(opcode >> 8), (uint8_t)(opcode & 0xFF)};
+    loadChip8(chip8, program, sizeof program, "bench");
+    chip8->V[1] = 8;
+    chip8->V[2] = 8;
+    chip8->I = 0x300;
+    memset(&chip8->ram[0x300], 0xFF, 16);
+}
+
+// emulateInstruction per opcode class: execute the instruction at 0x200 over and over,
+// PC, I and stack are put back first (included in the time)
+void benchOpcodes(const config_t config)
+{
+    static chip8_t chip8;
+    for (uint32_t op = 0; op < OP_CLASSES; op++)
+    {
+        setupOpcode(&chip8, class_samples[op]);
+        uint64_t iters;
+        const double ns = timeBest([&]()
+                                   {
+                                       for (uint32_t i = 0; i < 1000; i++)
+                                       {
+                                           chip8.PC = 0x200;
+                                           chip8.I = 0x300;
+                                           chip8.sp = 1; // one return address for 00EE, room for 2NNN
+                                           emulateInstruction(&chip8, config);
+                                       }
+                                       sink += chip8.V[1]; },
+                                   1000, &iters);
+        printResult("opcode", opcode_info[op].name, ns, iters);
+    }
+}
+
+// DXYN by sprite height and position: aligned, unaligned, clipped at the right and bottom edges, wrapped
+void benchDraw(const config_t config)
+{
+    static chip8_t chip8;
+    const struct
+    {
+        const char *name;
+        uint8_t x, y;
+    } positions[] = {{"aligned", 8, 8}, {"unaligned", 11, 8}, {"right_edge", 60, 8}, {"bottom_edge", 8, 28}, {"wrapped", 70, 40}};
+    const uint8_t heights[] = {1, 2, 4, 8, 15};
+
+    for (const auto &position : positions)
+        for (uint8_t height : heights)
+        {
+            setupOpcode(&chip8, 0xD120 | height);
+            chip8.V[1] = position.x;
+            chip8.V[2] = position.y;
+            uint64_t iters;
+            const double ns = timeBest([&]()
+                                       {
+                                           for (uint32_t i = 0; i < 1000; i++)
+                                           {
+                                               chip8.PC = 0x200;
+                                               emulateInstruction(&chip8, config);
+                                           }
+                                           sink += chip8.V[0xF]; },
+                                       1000, &iters);
+            char name[64];
+            snprintf(name, sizeof name, "%s_h%u", position.name, height);
+            printResult("draw", name, ns, iters);
+        }
+}
+
+// Synthetic stress ROMs, each an endless loop of one kind of work, run through emulateFrame
+typedef struct
+{
+    const char *name;
+    std::vector<uint8_t> program;
+} stress_rom_t;
+
+std::vector<stress_rom_t> stressRoms()
+{
+    return {
+        // V0 += V1, V2 ^= V0, V3 += 1 ...
+        {"alu", {0x61, 0x03, 0x80, 0x14, 0x82, 0x03, 0x73, 0x01, 0x84, 0x35, 0x85, 0x4E, 0x12, 0x02}},
+        // full 15 row sprites at unaligned positions, X moves each pass
+        {"draw", {0xA0, 0x00, 0x62, 0x03, 0xD1, 0x2F, 0xD1, 0x2F, 0x71, 0x05, 0xD1, 0x2F, 0x12, 0x04}},
+        // BCD, register dump and load
+        {"memory", {0xA3, 0x00, 0xF0, 0x33, 0xFF, 0x55, 0xFF, 0x65, 0x70, 0x01, 0x12, 0x00}},
+        // call and return
+        {"calls", {0x22, 0x04, 0x12, 0x00, 0x70, 0x01, 0x00, 0xEE}},
+        // skips taken and not taken
+        {"branches", {0x70, 0x01, 0x30, 0x80, 0x71, 0x01, 0x50, 0x10, 0x72, 0x01, 0x12, 0x00}},
+    };
+}
+
+// Whole frames: ROMs from the ROM directory and the synthetic stress ROMs
+void benchFrames(const config_t config, const std::vector<std::string> &roms)
+{
+    static chip8_t boot, chip8;
+    const auto run = [&](const char *name)
+    {
+        chip8 = boot;
+        uint64_t iters;
+        const double ns = timeBest([&]()
+                                   {
+                                       emulateFrame(&chip8, config, NULL);
+                                       sink += chip8.PC; },
+                                   1, &iters);
+        printResult("frame", name, ns, iters);
+    };
+
+    for (const std::string &rom : roms)
+        if (initChip8(&boot, rom.c_str()))
+            run(std::filesystem::path(rom).filename().string().c_str());
+    for (const stress_rom_t &rom : stressRoms())
+        if (loadChip8(&boot, rom.program.data(), rom.program.size(), rom.name))
+        {
+            std::string name = std::string("stress_") + rom.name;
+            run(name.c_str());
+        }
+}
+
+// initChip8 boot time per ROM file (file read included)
+void benchBoot(const std::vector<std::string> &roms)
+{
+    static chip8_t chip8;
+    for (const std::string &rom : roms)
+    {
+        uint64_t iters;
+        const double ns = timeBest([&]()
+                                   {
+                                       initChip8(&chip8, rom.c_str());
+                                       sink += chip8.ram[0x200]; },
+                                   1, &iters);
+        printResult("boot", std::filesystem::path(rom).filename().string().c_str(), ns, iters);
+    }
+}
+
+// Save state serialize and restore
+void benchState(const std::vector<std::string> &roms, const config_t config)
+{
+    static chip8_t chip8;
+    if (roms.empty() || !initChip8(&chip8, roms[0].c_str()))
+        return;
+    for (uint32_t f = 0; f < 60; f++)
+        emulateFrame(&chip8, config, NULL);
+
+    static uint8_t buf[STATE_SIZE];
+    uint64_t iters;
+    double ns = timeBest([&]()
+                         { sink += saveState(&chip8, buf, sizeof buf); },
+                         1, &iters);
+    printResult("state", "save", ns, iters);
+    ns = timeBest([&]()
+                  { sink += loadState(&chip8, buf, sizeof buf); },
+                  1, &iters);
+    printResult("state", "load", ns, iters);
+}
+
+// updateScreen per pixel scale, on a checkerboard so both colors are drawn
+void benchRender(config_t config)
+{
+    config.pixelscale = 20;
+    sdl_t sdl = {0};
+    if (!initSDl(&sdl, &config))
+        return;
+
+    static chip8_t chip8;
+    for (uint32_t i = 0; i < sizeof chip8.display; i++)
+        chip8.display[i] = ((i % 64) + (i / 64)) & 1;
+
+    const uint32_t scales[] = {1, 4, 10, 20};
+    for (uint32_t scale : scales)
+    {
+        config.pixelscale = scale;
+        uint64_t iters;
+        const double ns = timeBest([&]()
+                                   { updateScreen(sdl, config, &chip8); },
+                                   1, &iters);
+        char name[32];
+        snprintf(name, sizeof name, "scale_%u", scale);
+        printResult("render", name, ns, iters);
+    }
+    cleanUp(&sdl);
+}
+
+int main(int argv, char **args)
+{
+    // emulator options (--ips, --headless to skip the SDL render benchmark) are shared with the emulator
+    config_t config = {0};
+    setupEmulator(&config, argv, args);
+
+    const char *rom_dir = "roms";
+    const char *only = NULL;
+    for (int i = 1; i < argv; i++)
+    {
+        if (strncmp(args[i], "--roms", strlen("--roms")) == 0)
+        {
+            i++;
+            rom_dir = args[i];
+        }
+        if (strncmp(args[i], "--only", strlen("--only")) == 0)
+        {
+            i++;
+            only = args[i];
+        }
+    }
+
+    std::vector<std::string> roms;
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(rom_dir, error))
+        if (entry.path().extension() == ".ch8")
+            roms.push_back(entry.path().string());
+    std::sort(roms.begin(), roms.end());
+
+    const auto selected = [only](const char *bench)
+    { return !only || strcmp(only, bench) == 0; };
+    if (selected("opcode"))
+        benchOpcodes(config);
+    if (selected("draw"))
+        benchDraw(config);
+    if (selected("frame"))
+        benchFrames(config, roms);
+    if (selected("boot"))
+        benchBoot(roms);
+    if (selected("state"))
+        benchState(roms, config);
+    if (selected("render") && !config.headless)
+        benchRender(config);
+    return 0;
+}
@@ -1,14 +1,7 @@
-#include <SDL2/SDL.h>
+#pragma once
 #include <stdio.h>
 #include <cstdint>
 
-// SDL Container
-typedef struct
-{
-    SDL_Window *window;
-    SDL_Renderer *renderer;
-} sdl_t;
-
 // options object
 typedef struct
 {
@@ -17,6 +10,23 @@ typedef struct
     uint32_t fg_color;      // Hex RGBA8888 foreground color & alpha
     uint32_t bg_color;      // Hex RGBA8888 background color & alpha
     uint32_t pixelscale;    // Scale pixel by factor
+    uint32_t insts_per_second; // CHIP8 CPU "clock rate", instructions emulated per second
+    bool ips_set;           // insts_per_second given on the command line, not taken from the ROM library
+    uint32_t sample_rate;   // Audio output sample rate in Hz
+    bool headless;          // Run without window or audio device
+    uint32_t frames;        // Stop after this many 60Hz frames, 0 runs until quit
+    const char *wav_path;   // Render audio to this WAV file instead of an audio device
+    uint32_t rewind_seconds; // Seconds of per-frame rewind history, 0 disables rewind
+    uint32_t seed;          // CXNN random number generator seed
+    const char *trace_path; // DEBUG builds: binary instruction trace file
+    const char *profile_path; // PROFILE builds: profile CSV file
+    const char *library_path; // ROM library index (chip8_library.h), NULL if none
+    const char *record_path;  // Capture the display to this Y4M, GIF or raw RGB24 file, NULL if none
+    const char *serve_address; // Stream the display on this local TCP port or Unix socket, NULL if none
+    const char *input_path;    // Scripted keypad input (chip8_input.h), NULL if none
+    const char *netplay_address; // "<local port>:<peer host>:<peer port>" for two player netplay, NULL if none
+    uint32_t rollback_frames;  // Netplay rollback window, frames
+    uint32_t run_ahead;        // Frames shown ahead of the emulated machine to hide game input lag, 0 off
 } config_t;
 
 // emulator states
@@ -38,21 +48,30 @@ typedef struct
     uint8_t Y;    // 4 bit register identifier
 } inst_t;
 
+struct tracer_t;  // chip8_trace.h
+struct profile_t; // chip8_profile.h
+
 // CHIP8 Machine object (For multiple displays)
 typedef struct
 {
     emulator_state_t state;
     uint8_t ram[4096];     // ram
     bool display[64 * 32]; // display
-    uint8_t stack[12];     // stack
-    uint8_t *stack_ptr;    // stack pointer
+    uint16_t stack[16];    // stack
     uint8_t V[16];         // v register (data register v0 to vf)
     uint16_t I;            // I register (index register)
     uint16_t PC;           // Program counter
     uint8_t delay_timer;   // -->60Hz when > 0
     uint8_t sound_timer;   // --> 60Hz & plays tone when > 0
+    uint8_t sp;            // stack pointer, entries are stack[sp & 0xF] so over/underflow wraps around
     bool keypad[16];       // Hex
     const char *rom_name;
     inst_t inst;           // currently executing instruction
     bool draw;             // Update the screen yes/no
+    uint8_t pattern[16];   // XO-CHIP 128 bit audio pattern buffer
+    uint8_t pitch;         // XO-CHIP audio pattern playback pitch
+    uint8_t await_key;     // FX0A key pressed and awaiting release, 0xFF if none yet
+    uint32_t rng;          // CXNN xorshift random number generator state
+    tracer_t *tracer;      // DEBUG builds: binary instruction trace, NULL if off
+    profile_t *profile;    // PROFILE builds: execution profile, NULL if off
 } chip8_t;
\ No newline at end of file
@@ -0,0 +1,298 @@
+#pragma once
+#include <stdio.h>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "chip8_map.h"
+#include "chip8_inflate.h"
+
+// ROM archives (zip with stored or deflated members, or tar), read in place through a mapping without
+// extracting anything to disk. Entries are walked in order: nextArchiveEntry only parses headers, so callers
+// can skip entries by name, size or time for free, and readArchiveEntry returns the contents, straight from
+// the mapping for stored zip and tar members or inflated into a buffer reused from entry to entry.
+
+typedef enum
+{
+    ARCHIVE_ZIP,
+    ARCHIVE_TAR,
+} archive_type_t;
+
+typedef struct
+{
+    const char *name; // path inside the archive, valid until the next nextArchiveEntry
+    uint32_t size;    // uncompressed bytes
+    int64_t mtime;    // seconds since 1970 (zip times are local time, taken as UTC)
+
+    const uint8_t *data; // compressed data in the mapping
+    size_t packed;       // compressed bytes
+    uint16_t method;     // zip compression method, 0 stored, 8 deflate
+    uint32_t crc;        // zip CRC-32 of the contents
+} archive_entry_t;
+
+typedef struct
+{
+    mapped_file_t file;
+    archive_type_t type;
+    const char *path;
+    size_t next;      // offset of the next zip central directory record or tar header
+    uint32_t left;    // zip central directory records left
+    char name[1024];  // current entry's name
+    uint8_t *buffer;  // inflated contents of the current entry
+    size_t capacity;
+} archive_t;
+
+uint16_t getLe16(const uint8_t *p) { return p[0] | p[1] << 8; }
+uint32_t getLe32(const uint8_t *p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24; }
+
+// Archives and ROMs are recognised by extension when scanning directories, archives by content when opened
+bool isArchiveName(const char *name)
+{
+    const char *extension = strrchr(name, '.');
+    return extension && (strcmp(extension, ".zip") == 0 || strcmp(extension, ".tar") == 0);
+}
+
+bool isRomName(const char *name)
+{
+    const char *extension = strrchr(name, '.');
+    return extension && (strcmp(extension, ".ch8") == 0 || strcmp(extension, ".c8") == 0 ||
+                         strcmp(extension, ".sc8") == 0 || strcmp(extension, ".xo8") == 0);
+}
+
+// Days from 1970-01-01 to a proleptic Gregorian date
+int64_t daysFromCivil(int64_t year, uint32_t month, uint32_t day)
+{
+    year -= month <= 2;
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const uint32_t year_of_era = (uint32_t)(year - era * 400);
+    const uint32_t day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const uint32_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+// Octal tar header number, -1 if malformed (or base-256, only used for sizes no ROM has)
+int64_t parseOctal(const uint8_t *field, size_t size)
+{
+    size_t i = 0;
+    while (i < size && field[i] == ' ')
+        i++;
+    int64_t value = 0;
+    bool digits = false;
+    for (; i < size && field[i] >= '0' && field[i] <= '7'; i++, digits = true)
+        value = value * 8 + (field[i] - '0');
+    if (!digits || (i < size && field[i] != ' ' && field[i] != '\0'))
+        return -1;
+    return value;
+}
+
+// Sum of a tar header's bytes with its checksum field taken as spaces
+int64_t tarChecksum(const uint8_t *header)
+{
+    int64_t sum = 0;
+    for (uint32_t i = 0; i < 512; i++)
+        sum += i >= 148 && i < 156 ? ' ' : header[i];
+    return sum;
+}
+
+void closeArchive(archive_t *archive)
+{
+    unmapFile(&archive->file);
+    free(archive->buffer);
+    memset(archive, 0, sizeof *archive);
+}
+
+bool openArchive(archive_t *archive, const char *path)
+{
+    memset(archive, 0, sizeof *archive);
+    archive->path = path;
+    if (!mapFile(&archive->file, path))
+    {
+        std::cout << "Archive " << path << " invalid or does not exist!\n";
+        return false;
+    }
+    const uint8_t *data = archive->file.data;
+    const size_t size = archive->file.size;
+
+    // tar: starts with a header whose checksum is right, ustar or the older format
+    if (size >= 512 && tarChecksum(data) == parseOctal(data + 148, 8))
+    {
+        archive->type = ARCHIVE_TAR;
+        return true;
+    }
+
+    // zip: end of central directory record, found backwards past a comment of up to 64KB
+    archive->type = ARCHIVE_ZIP;
+    for (size_t end = size >= 22 ? size - 22 + 1 : 0; end-- > 0 && size - end <= 22 + 0xFFFF;)
+    {
+        if (getLe32(data + end) != 0x06054B50)
+            continue;
+        const uint32_t records = getLe16(data + end + 10);
+        const uint32_t directory_size = getLe32(data + end + 12);
+        const uint32_t directory = getLe32(data + end + 16);
+        if (records == 0xFFFF || directory == 0xFFFFFFFF)
+        {
+            std::cout << "Archive " << path << " is zip64, not supported\n";
+            closeArchive(archive);
+            return false;
+        }
+        if ((size_t)directory + directory_size > end)
+            break;
+        archive->next = directory;
+        archive->left = records;
+        return true;
+    }
+    std::cout << "Archive " << path << " is not a zip or tar archive\n";
+    closeArchive(archive);
+    return false;
+}
+
+// Next zip member from the central directory; sizes come from there too, so members written with data
+// descriptors need no special case
+bool nextZipEntry(archive_t *archive, archive_entry_t *entry)
+{
+    const uint8_t *data = archive->file.data;
+    const size_t size = archive->file.size;
+    while (archive->left)
+    {
+        const size_t at = archive->next;
+        if (at + 46 > size || getLe32(data + at) != 0x02014B50)
+            break;
+        const uint16_t flags = getLe16(data + at + 8);
+        const uint16_t time = getLe16(data + at + 12), date = getLe16(data + at + 14);
+        const uint32_t name_size = getLe16(data + at + 28);
+        const size_t record_size = 46 + name_size + getLe16(data + at + 30) + getLe16(data + at + 32);
+        const size_t local = getLe32(data + at + 42);
+        if (at + record_size > size || local + 30 > size || getLe32(data + local) != 0x04034B50)
+            break;
+        const size_t start = local + 30 + getLe16(data + local + 26) + getLe16(data + local + 28);
+        const size_t packed = getLe32(data + at + 20);
+        if (start > size || packed > size - start)
+            break;
+        archive->next = at + record_size;
+        archive->left--;
+        const char *name = (const char *)data + at + 46;
+        if (name_size == 0 || name[name_size - 1] == '/') // directory
+            continue;
+
+        entry->method = getLe16(data + at + 10);
+        entry->crc = getLe32(data + at + 16);
+        entry->packed = packed;
+        entry->size = getLe32(data + at + 24);
+        entry->data = data + start;
+        if (flags & 1)
+            entry->method = 0xFFFF; // encrypted
+        entry->mtime = daysFromCivil(1980 + (date >> 9), (date >> 5) & 0xF, date & 0x1F) * 86400 +
+                       (time >> 11) * 3600 + ((time >> 5) & 0x3F) * 60 + (time & 0x1F) * 2;
+        const size_t copy = name_size < sizeof archive->name ? name_size : sizeof archive->name - 1;
+        memcpy(archive->name, name, copy);
+        archive->name[copy] = '\0';
+        entry->name = archive->name;
+        return true;
+    }
+    if (archive->left)
+    {
+        std::cout << "Archive " << archive->path << " has a corrupt central directory\n";
+        archive->left = 0;
+    }
+    return false;
+}
+
+// Next regular file of a tar, GNU long names included, other special entries skipped
+bool nextTarEntry(archive_t *archive, archive_entry_t *entry)
+{
+    const uint8_t *data = archive->file.data;
+    const size_t size = archive->file.size;
+    bool long_name = false;
+    while (archive->next + 512 <= size)
+    {
+        const uint8_t *header = data + archive->next;
+        if (header[0] == '\0') // end of archive block
+            break;
+        const int64_t file_size = parseOctal(header + 124, 12);
+        if (parseOctal(header + 148, 8) != tarChecksum(header) || file_size < 0 || (uint64_t)file_size > size - archive->next - 512)
+        {
+            std::cout << "Archive " << archive->path << " has a corrupt header at " << archive->next << "\n";
+            break;
+        }
+        archive->next += 512 + ((file_size + 511) & ~(int64_t)511);
+        const uint8_t type = header[156];
+        if (type == 'L') // GNU long name of the next entry
+        {
+            const size_t copy = (size_t)file_size < sizeof archive->name ? (size_t)file_size : sizeof archive->name - 1;
+            memcpy(archive->name, header + 512, copy);
+            archive->name[copy] = '\0';
+            long_name = true;
+            continue;
+        }
+        if (type != '0' && type != '\0' && type != '7')
+        {
+            long_name = false;
+            continue;
+        }
+        if (!long_name)
+        {
+            // ustar prefix "/" name, both NUL terminated unless full
+            char prefix[156] = {0}, base[101] = {0};
+            if (memcmp(header + 257, "ustar", 5) == 0)
+                memcpy(prefix, header + 345, 155);
+            memcpy(base, header, 100);
+            snprintf(archive->name, sizeof archive->name, "%s%s%s", prefix, prefix[0] ? "/" : "", base);
+        }
+        entry->name = archive->name;
+        entry->size = (uint32_t)file_size;
+        entry->mtime = parseOctal(header + 136, 12);
+        entry->data = header + 512;
+        entry->packed = (size_t)file_size;
+        entry->method = 0;
+        entry->crc = 0;
+        return true;
+    }
+    archive->next = size;
+    return false;
+}
+
+// Advance to the next file in the archive, false at the end
+bool nextArchiveEntry(archive_t *archive, archive_entry_t *entry)
+{
+    return archive->type == ARCHIVE_ZIP ? nextZipEntry(archive, entry) : nextTarEntry(archive, entry);
+}
+
+// Contents of the current entry (entry->size bytes), NULL if it can't be read. Valid until the next call.
+const uint8_t *readArchiveEntry(archive_t *archive, const archive_entry_t *entry)
+{
+    if (archive->type == ARCHIVE_TAR)
+        return entry->data;
+
+    const uint8_t *contents;
+    if (entry->method == 0 && entry->packed == entry->size)
+        contents = entry->data;
+    else if (entry->method == 8)
+    {
+        if (entry->size > archive->capacity || !archive->buffer)
+        {
+            const size_t capacity = entry->size ? entry->size : 1; // empty members still return a pointer
+            uint8_t *buffer = (uint8_t *)realloc(archive->buffer, capacity);
+            if (!buffer)
+                return NULL;
+            archive->buffer = buffer;
+            archive->capacity = capacity;
+        }
+        if (!inflateRaw(entry->data, entry->packed, archive->buffer, entry->size))
+        {
+            std::cout << "Archive " << archive->path << ": " << entry->name << " is corrupt\n";
+            return NULL;
+        }
+        contents = archive->buffer;
+    }
+    else
+    {
+        std::cout << "Archive " << archive->path << ": " << entry->name << " uses an unsupported compression method\n";
+        return NULL;
+    }
+    if (computeCrc32(contents, entry->size) != entry->crc)
+    {
+        std::cout << "Archive " << archive->path << ": " << entry->name << " fails its CRC check\n";
+        return NULL;
+    }
+    return contents;
+}
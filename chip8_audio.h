@@ -0,0 +1,239 @@
+#pragma once
+#include <stdio.h>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <atomic>
+#include <iostream>
+
+// Audio queue size, max pattern/pitch/gate changes in flight between emulator and audio callback
+#define AUDIO_QUEUE_SIZE 256
+
+// WAV file block size in samples, audio is streamed to disk in blocks of this size
+#define WAV_BLOCK_SIZE 4096
+
+// Audio change, applied by the synthesizer once its output reaches sample position "at"
+typedef struct
+{
+    uint64_t at;         // sample position the change takes effect
+    uint8_t pattern[16]; // 128 bit (1-bit per sample) audio pattern
+    uint8_t pitch;       // XO-CHIP pitch, playback rate = 4000 * 2^((pitch - 64) / 48) Hz
+    bool gate;           // sound timer > 0
+} audio_event_t;
+
+// 1-bit pattern synthesizer
+typedef struct
+{
+    uint32_t sample_rate;
+    uint32_t phase_inc[256]; // phase increment per output sample for each pitch, 128 bits == 2^32
+    int16_t volume;
+
+    // playback state, owned by the audio callback
+    uint8_t pattern[16];
+    uint32_t phase; // position in pattern, top 7 bits are the bit index
+    uint32_t inc;
+    bool gate;
+    std::atomic<uint64_t> sample_pos; // samples rendered so far
+
+    // single producer (emulator) single consumer (audio callback) change queue
+    audio_event_t queue[AUDIO_QUEUE_SIZE];
+    std::atomic<uint32_t> head; // next event to apply
+    std::atomic<uint32_t> tail; // next free slot
+
+    // emulator side timeline
+    uint64_t frames;  // 60Hz frames emulated so far
+    int64_t offset;   // emulated -> output sample position offset (real time playback only)
+    uint32_t latency; // samples to schedule ahead of the audio callback, 0 for offline rendering
+} audio_t;
+
+// initialize synthesizer, precompute phase increment per pitch
+void initAudio(audio_t *audio, uint32_t sample_rate, uint32_t latency)
+{
+    audio->sample_rate = sample_rate;
+    audio->volume = 3000;
+    for (uint32_t pitch = 0; pitch < 256; pitch++)
+    {
+        const double rate = 4000.0 * pow(2.0, ((double)pitch - 64.0) / 48.0); // pattern bits per second
+        audio->phase_inc[pitch] = (uint32_t)(rate * (double)(1u << 25) / sample_rate + 0.5);
+    }
+
+    memset(audio->pattern, 0, sizeof audio->pattern);
+    audio->phase = 0;
+    audio->inc = audio->phase_inc[64];
+    audio->gate = false;
+    audio->sample_pos = 0;
+    audio->head = 0;
+    audio->tail = 0;
+    audio->frames = 0;
+    audio->offset = latency;
+    audio->latency = latency;
+}
+
+// queue a pattern/pitch/gate change at emulated sample position "at", called from the emulator thread
+void pushAudioEvent(audio_t *audio, uint64_t at, const uint8_t pattern[16], uint8_t pitch, bool gate)
+{
+    const uint32_t tail = audio->tail.load(std::memory_order_relaxed);
+    if (tail - audio->head.load(std::memory_order_acquire) >= AUDIO_QUEUE_SIZE)
+        return; // Queue full, audio callback stalled; drop the change
+
+    audio_event_t *event = &audio->queue[tail % AUDIO_QUEUE_SIZE];
+    event->at = (uint64_t)((int64_t)at + audio->offset);
+    memcpy(event->pattern, pattern, sizeof event->pattern);
+    event->pitch = pitch;
+    event->gate = gate;
+    audio->tail.store(tail + 1, std::memory_order_release);
+}
+
+// Sample position of the start of a 60Hz frame
+uint64_t frameSample(const audio_t *audio, uint64_t frame)
+{
+    return frame * audio->sample_rate / 60;
+}
+
+// Keep emulated timeline within one frame of the audio callback's clock, emulation and audio device drift apart over time
+void syncAudio(audio_t *audio)
+{
+    if (!audio->latency)
+        return; // Offline rendering, output clock is the emulated clock
+
+    const int64_t now = (int64_t)audio->sample_pos.load(std::memory_order_relaxed) + audio->latency;
+    const int64_t at = (int64_t)frameSample(audio, audio->frames) + audio->offset;
+    const int64_t frame_len = audio->sample_rate / 60;
+    if (at < now - frame_len || at > now + frame_len)
+        audio->offset = now - (int64_t)frameSample(audio, audio->frames);
+}
+
+// Render "count" samples of signed 16-bit mono audio. Called from the audio callback, does not allocate or lock
+void renderAudio(audio_t *audio, int16_t *out, uint32_t count)
+{
+    uint64_t pos = audio->sample_pos.load(std::memory_order_relaxed);
+    const uint64_t end = pos + count;
+
+    while (pos < end)
+    {
+        // Apply all changes due by now, then render up to the next pending change
+        uint64_t run_end = end;
+        uint32_t head = audio->head.load(std::memory_order_relaxed);
+        while (head != audio->tail.load(std::memory_order_acquire))
+        {
+            const audio_event_t *event = &audio->queue[head % AUDIO_QUEUE_SIZE];
+            if (event->at > pos)
+            {
+                if (event->at < run_end)
+                    run_end = event->at;
+                break;
+            }
+            memcpy(audio->pattern, event->pattern, sizeof audio->pattern);
+            audio->inc = audio->phase_inc[event->pitch];
+            audio->gate = event->gate;
+            audio->head.store(++head, std::memory_order_release);
+        }
+
+        if (!audio->gate)
+        {
+            memset(out, 0, (run_end - pos) * sizeof *out);
+            out += run_end - pos;
+            pos = run_end;
+            continue;
+        }
+
+        for (; pos < run_end; pos++)
+        {
+            // Box filter: average the pattern bits covered by this output sample
+            uint32_t phase = audio->phase;
+            uint64_t left = audio->inc;
+            uint64_t on = 0;
+            while (left)
+            {
+                const uint32_t bit = phase >> 25;
+                const uint64_t step = ((uint64_t)(bit + 1) << 25) - phase; // distance to next bit
+                const uint32_t span = (uint32_t)(left < step ? left : step);
+                if (audio->pattern[bit >> 3] & (0x80 >> (bit & 7)))
+                    on += span;
+                phase += span;
+                left -= span;
+            }
+            audio->phase = phase;
+            // on/inc is 0..1 coverage, map to -volume..volume
+            *out++ = audio->inc ? (int16_t)(((int64_t)(2 * on) - audio->inc) * audio->volume / (int64_t)audio->inc) : 0;
+        }
+    }
+    audio->sample_pos.store(pos, std::memory_order_relaxed);
+}
+
+// Streaming 16-bit mono WAV writer
+typedef struct
+{
+    FILE *file;
+    uint64_t samples; // samples written so far
+    int16_t block[WAV_BLOCK_SIZE];
+    uint8_t bytes[WAV_BLOCK_SIZE * 2]; // block as little endian bytes
+} wav_t;
+
+// write little endian 16/32-bit values, WAV is little endian regardless of host
+void writeLE(FILE *file, uint32_t value, uint8_t bytes)
+{
+    for (uint8_t i = 0; i < bytes; i++)
+        fputc((value >> (8 * i)) & 0xFF, file);
+}
+
+// RIFF/WAVE header, sizes are patched in closeWav once known
+void writeWavHeader(wav_t *wav, uint32_t sample_rate)
+{
+    const uint64_t max_data = 0xFFFFFFFFull - 36; // RIFF sizes are 32-bit
+    const uint64_t data_size = wav->samples * 2 < max_data ? wav->samples * 2 : max_data;
+
+    fputs("RIFF", wav->file);
+    writeLE(wav->file, (uint32_t)(36 + data_size), 4);
+    fputs("WAVEfmt ", wav->file);
+    writeLE(wav->file, 16, 4);              // fmt chunk size
+    writeLE(wav->file, 1, 2);               // PCM
+    writeLE(wav->file, 1, 2);               // mono
+    writeLE(wav->file, sample_rate, 4);     // sample rate
+    writeLE(wav->file, sample_rate * 2, 4); // byte rate
+    writeLE(wav->file, 2, 2);               // block align
+    writeLE(wav->file, 16, 2);              // bits per sample
+    fputs("data", wav->file);
+    writeLE(wav->file, (uint32_t)data_size, 4);
+}
+
+bool openWav(wav_t *wav, const char *path, uint32_t sample_rate)
+{
+    wav->file = fopen(path, "wb");
+    if (!wav->file)
+    {
+        std::cout << "Could not open WAV file " << path << "\n";
+        return false;
+    }
+    wav->samples = 0;
+    writeWavHeader(wav, sample_rate);
+    return true;
+}
+
+// Render synthesizer output up to sample position "end" and stream it to the WAV file block by block
+void renderWav(wav_t *wav, audio_t *audio, uint64_t end)
+{
+    while (audio->sample_pos.load(std::memory_order_relaxed) < end)
+    {
+        const uint64_t left = end - audio->sample_pos.load(std::memory_order_relaxed);
+        const uint32_t count = left < WAV_BLOCK_SIZE ? (uint32_t)left : WAV_BLOCK_SIZE;
+        renderAudio(audio, wav->block, count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            wav->bytes[2 * i] = (uint16_t)wav->block[i] & 0xFF;
+            wav->bytes[2 * i + 1] = (uint16_t)wav->block[i] >> 8;
+        }
+        fwrite(wav->bytes, 2, count, wav->file);
+        wav->samples += count;
+    }
+}
+
+void closeWav(wav_t *wav, uint32_t sample_rate)
+{
+    if (!wav->file)
+        return;
+    rewind(wav->file);
+    writeWavHeader(wav, sample_rate); // patch RIFF and data chunk sizes
+    fclose(wav->file);
+    wav->file = NULL;
+}
@@ -0,0 +1,940 @@
+#pragma once
+#include <stdio.h>
+#include <cstring>
+#include <iostream>
+#include <chrono>
+
+#include "chip8.h"
+#include "chip8_map.h"
+#include "chip8_audio.h"
+#include "chip8_opcodes.h"
+#ifdef DEBUG
+#include "chip8_trace.h"
+#endif
+#ifdef PROFILE
+#include "chip8_profile.h"
+#endif
+
+// Milliseconds since "start"
+double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool setupEmulator(config_t *config, int argv, char **args)
+{
+    // default width & height values for CHIP 8, also used as default emulator config
+    *config = (config_t){
+        .window_width = 64,
+        .window_height = 32,
+        .fg_color = 0xFFFFFFFF, // white
+        .bg_color = 0x00000000, // black
+        .pixelscale = 20,
+        .insts_per_second = 700, // CHIP8 CPU clock rate
+        .ips_set = false,
+        .sample_rate = 44100,
+        .headless = false,
+        .frames = 0,
+        .wav_path = NULL,
+        .rewind_seconds = 10,
+        .seed = 0,
+        .trace_path = "chip8.trace",
+        .profile_path = "chip8-profile.csv",
+        .library_path = NULL,
+        .record_path = NULL,
+        .serve_address = NULL,
+        .input_path = NULL,
+        .netplay_address = NULL,
+        .rollback_frames = 8,
+        .run_ahead = 0,
+    };
+
+    // Override defaults from passed in arguments
+    for (int i = 1; i < argv; i++)
+    {
+        (void)args[i]; // Prevent compiler error from unused variables argc/argv
+        // e.g. set scale factor
+        if (strncmp(args[i], "--scale-factor", strlen("--scale-factor")) == 0)
+        {
+            // Note: should probably add checks for numeric
+            i++;
+            config->pixelscale = (uint32_t)strtol(args[i], NULL, 10);
+        }
+        // e.g. set instructions emulated per second
+        if (strncmp(args[i], "--ips", strlen("--ips")) == 0)
+        {
+            i++;
+            config->insts_per_second = (uint32_t)strtol(args[i], NULL, 10);
+            config->ips_set = true;
+        }
+        // e.g. run without window or audio device
+        if (strncmp(args[i], "--headless", strlen("--headless")) == 0)
+        {
+            config->headless = true;
+        }
+        // e.g. stop after N frames
+        if (strncmp(args[i], "--frames", strlen("--frames")) == 0)
+        {
+            i++;
+            config->frames = (uint32_t)strtol(args[i], NULL, 10);
+        }
+        // e.g. render audio to a WAV file (headless only)
+        if (strncmp(args[i], "--wav", strlen("--wav")) == 0)
+        {
+            i++;
+            config->wav_path = args[i];
+        }
+        // e.g. set audio sample rate
+        if (strncmp(args[i], "--sample-rate", strlen("--sample-rate")) == 0)
+        {
+            i++;
+            config->sample_rate = (uint32_t)strtol(args[i], NULL, 10);
+        }
+        // e.g. seconds of rewind history
+        if (strncmp(args[i], "--rewind", strlen("--rewind")) == 0)
+        {
+            i++;
+            config->rewind_seconds = (uint32_t)strtol(args[i], NULL, 10);
+        }
+        // e.g. seed the CXNN random numbers
+        if (strncmp(args[i], "--seed", strlen("--seed")) == 0)
+        {
+            i++;
+            config->seed = (uint32_t)strtoul(args[i], NULL, 0);
+        }
+        // e.g. write the DEBUG instruction trace elsewhere
+        if (strncmp(args[i], "--trace", strlen("--trace")) == 0)
+        {
+            i++;
+            config->trace_path = args[i];
+        }
+        // e.g. write the PROFILE build's CSV elsewhere
+        if (strncmp(args[i], "--profile", strlen("--profile")) == 0)
+        {
+            i++;
+            config->profile_path = args[i];
+        }
+        // e.g. take the ROM's speed from a ROM library index
+        if (strncmp(args[i], "--library", strlen("--library")) == 0)
+        {
+            i++;
+            config->library_path = args[i];
+        }
+        // e.g. capture the display to a video file
+        if (strncmp(args[i], "--record", strlen("--record")) == 0)
+        {
+            i++;
+            config->record_path = args[i];
+        }
+        // e.g. stream the display to viewers
+        if (strncmp(args[i], "--serve", strlen("--serve")) == 0)
+        {
+            i++;
+            config->serve_address = args[i];
+        }
+        // e.g. play keypad input from a script
+        if (strncmp(args[i], "--input", strlen("--input")) == 0)
+        {
+            i++;
+            config->input_path = args[i];
+        }
+        // e.g. play with a second player over the network
+        if (strncmp(args[i], "--netplay", strlen("--netplay")) == 0)
+        {
+            i++;
+            config->netplay_address = args[i];
+        }
+        // e.g. netplay rollback window in frames
+        if (strncmp(args[i], "--rollback", strlen("--rollback")) == 0)
+        {
+            i++;
+            config->rollback_frames = (uint32_t)strtol(args[i], NULL, 10);
+        }
+        // e.g. show frames ahead to cut input lag
+        if (strncmp(args[i], "--run-ahead", strlen("--run-ahead")) == 0)
+        {
+            i++;
+            config->run_ahead = (uint32_t)strtol(args[i], NULL, 10);
+        }
+    }
+
+    return true;
+}
+
+// Seed CXNN random numbers. The seed is mixed (murmur3 finalizer) so nearby seeds give unrelated sequences,
+// xorshift state must not be 0.
+void seedChip8(chip8_t *chip8, uint32_t seed)
+{
+    uint32_t x = seed;
+    x ^= x >> 16;
+    x *= 0x85EBCA6B;
+    x ^= x >> 13;
+    x *= 0xC2B2AE35;
+    x ^= x >> 16;
+    chip8->rng = x ? x : 0x2545F491;
+}
+
+// initialize CHIP8 machine from a ROM image in memory
+bool loadChip8(chip8_t *chip8, const uint8_t *rom, size_t rom_size, const char *rom_name)
+{
+    const uint32_t entry_point = 0x200; // CHIP8 roms loaded into 0x200 in the memory
+    // load font
+    const uint8_t font[] = {
+        0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+        0x20, 0x60, 0x20, 0x20, 0x70, // 1
+        0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+        0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+        0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+        0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+        0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+        0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+        0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+        0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+        0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+        0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+        0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+        0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+        0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+        0xF0, 0x80, 0xF0, 0x80, 0x80, // F
+    };
+
+    memset(chip8, 0, sizeof(chip8_t));
+    std::memcpy(&chip8->ram[0], font, sizeof(font));
+
+    // load ROM
+    const size_t max_size = sizeof chip8->ram - entry_point;
+    if (rom_size > max_size)
+    {
+        std::cout << "ROM " << rom_name << " too big(" << rom_size << ") to be loaded, max size: " << max_size << "\n";
+        return false;
+    }
+    if (rom_size) // empty ROMs map to NULL
+        memcpy(&chip8->ram[entry_point], rom, rom_size);
+
+    chip8->state = RUNNING;  // Default machine state
+    chip8->PC = entry_point; // program counter
+    chip8->rom_name = rom_name;
+    memset(chip8->pattern, 0xF0, sizeof chip8->pattern); // Default 500Hz square wave buzzer
+    chip8->pitch = 64;                                     // 4000Hz pattern playback rate
+    chip8->await_key = 0xFF;                               // No key awaited by FX0A
+    seedChip8(chip8, 0);                                   // Default CXNN seed
+    return true; // Success
+}
+
+// initialize CHIP8 machine from a ROM file, copied straight from the mapped file into ram
+bool initChip8(chip8_t *chip8, const char rom_name[])
+{
+    mapped_file_t rom;
+    if (!mapFile(&rom, rom_name))
+    {
+        std::cout << "ROM" << rom_name << "invalid or does not exist!\n"; // error
+        return false;
+    }
+    const bool ok = loadChip8(chip8, rom.data, rom.size, rom_name);
+    unmapFile(&rom);
+    return ok;
+}
+
+// print debug output
+#ifdef DEBUG
+void print_debug_info(chip8_t *chip8)
+{
+    printf("Address: 0x%04X, Opcode: 0x%04X Desc: ",
+           chip8->PC - 2, chip8->inst.opcode);
+
+    const opcode_class_t op = opcodeClass(chip8->inst.opcode);
+    switch (op)
+    {
+    case OP_00E0:
+    case OP_0NNN:
+        printf("%s\n", opcode_info[op].description);
+        break;
+
+    case OP_00EE:
+        // Set program counter to last address on subroutine stack ("pop" it off the stack)
+        //   so that next opcode will be gotten from that address.
+        printf("Return from subroutine to address 0x%04X\n",
+               chip8->stack[(chip8->sp - 1) & 0xF]);
+        break;
+
+    case OP_1NNN:
+        printf("Jump to address NNN (0x%04X)\n",
+               chip8->inst.NNN);
+        break;
+
+    case OP_2NNN:
+        // Store current address to return to on subroutine stack ("push" it on the stack)
+        //   and set program counter to subroutine address so that the next opcode
+        //   is gotten from there.
+        printf("Call subroutine at NNN (0x%04X)\n",
+               chip8->inst.NNN);
+        break;
+
+    case OP_3XNN:
+        printf("Check if V%X (0x%02X) == NN (0x%02X), skip next instruction if true\n",
+               chip8->inst.X, chip8->V[chip8->inst.X], chip8->inst.NN);
+        break;
+
+    case OP_4XNN:
+        printf("Check if V%X (0x%02X) != NN (0x%02X), skip next instruction if true\n",
+               chip8->inst.X, chip8->V[chip8->inst.X], chip8->inst.NN);
+        break;
+
+    case OP_5XY0:
+        printf("Check if V%X (0x%02X) == V%X (0x%02X), skip next instruction if true\n",
+               chip8->inst.X, chip8->V[chip8->inst.X],
+               chip8->inst.Y, chip8->V[chip8->inst.Y]);
+        break;
+
+    case OP_6XNN:
+        printf("Set register V%X = NN (0x%02X)\n",
+               chip8->inst.X, chip8->inst.NN);
+        break;
+
+    case OP_7XNN:
+        printf("Set register V%X (0x%02X) += NN (0x%02X). Result: 0x%02X\n",
+               chip8->inst.X, chip8->V[chip8->inst.X], chip8->inst.NN,
+               chip8->V[chip8->inst.X] + chip8->inst.NN);
+        break;
+
+    case OP_8XY0:
+        printf("Set register V%X = V%X (0x%02X)\n",
+               chip8->inst.X, chip8->inst.Y, chip8->V[chip8->inst.Y]);
+        break;
+
+    case OP_8XY1:
+        printf("Set register V%X (0x%02X) |= V%X (0x%02X); Result: 0x%02X\n",
+               chip8->inst.X, chip8->V[chip8->inst.X],
+               chip8->inst.Y, chip8->V[chip8->inst.Y],
+               chip8->V[chip8->inst.X] | chip8->V[chip8->inst.Y]);
+        break;
+
+    case OP_8XY2:
+        printf("Set register V%X (0x%02X) &= V%X (0x%02X); Result: 0x%02X\n",
+               chip8->inst.X, chip8->V[chip8->inst.X],
+               chip8->inst.Y, chip8->V[chip8->inst.Y],
+               chip8->V[chip8->inst.X] & chip8->V[chip8->inst.Y]);
+        break;
+
+    case OP_8XY3:
+        printf("Set register V%X (0x%02X) ^= V%X (0x%02X); Result: 0x%02X\n",
+               chip8->inst.X, chip8->V[chip8->inst.X],
+               chip8->inst.Y, chip8->V[chip8->inst.Y],
+               chip8->V[chip8->inst.X] ^ chip8->V[chip8->inst.Y]);
+        break;
+
+    case OP_8XY4:
+        printf("Set register V%X (0x%02X) += V%X (0x%02X), VF = 1 if carry; Result: 0x%02X, VF = %X\n",
+               chip8->inst.X, chip8->V[chip8->inst.X],
+               chip8->inst.Y, chip8->V[chip8->inst.Y],
+               chip8->V[chip8->inst.X] + chip8->V[chip8->inst.Y],
+               ((uint16_t)(chip8->V[chip8->inst.X] + chip8->V[chip8->inst.Y]) > 255));
+        break;
+
+    case OP_8XY5:
+        printf("Set register V%X (0x%02X) -= V%X (0x%02X), VF = 1 if no borrow; Result: 0x%02X, VF = %X\n",
+               chip8->inst.X, chip8->V[chip8->inst.X],
+               chip8->inst.Y, chip8->V[chip8->inst.Y],
+               chip8->V[chip8->inst.X] - chip8->V[chip8->inst.Y],
+               (chip8->V[chip8->inst.Y] <= chip8->V[chip8->inst.X]));
+        break;
+
+    case OP_8XY6:
+        printf("Set register V%X (0x%02X) >>= 1, VF = shifted off bit (%X); Result: 0x%02X\n",
+               chip8->inst.X, chip8->V[chip8->inst.X],
+               chip8->V[chip8->inst.X] & 1,
+               chip8->V[chip8->inst.X] >> 1);
+        break;
+
+    case OP_8XY7:
+        printf("Set register V%X = V%X (0x%02X) - V%X (0x%02X), VF = 1 if no borrow; Result: 0x%02X, VF = %X\n",
+               chip8->inst.X, chip8->inst.Y, chip8->V[chip8->inst.Y],
+               chip8->inst.X, chip8->V[chip8->inst.X],
+               chip8->V[chip8->inst.Y] - chip8->V[chip8->inst.X],
+               (chip8->V[chip8->inst.X] <= chip8->V[chip8->inst.Y]));
+        break;
+
+    case OP_8XYE:
+        printf("Set register V%X (0x%02X) <<= 1, VF = shifted off bit (%X); Result: 0x%02X\n",
+               chip8->inst.X, chip8->V[chip8->inst.X],
+               (chip8->V[chip8->inst.X] & 0x80) >> 7,
+               chip8->V[chip8->inst.X] << 1);
+        break;
+
+    case OP_9XY0:
+        printf("Check if V%X (0x%02X) != V%X (0x%02X), skip next instruction if true\n",
+               chip8->inst.X, chip8->V[chip8->inst.X],
+               chip8->inst.Y, chip8->V[chip8->inst.Y]);
+        break;
+
+    case OP_ANNN:
+        printf("Set I to NNN (0x%04X)\n",
+               chip8->inst.NNN);
+        break;
+
+    case OP_BNNN:
+        printf("Set PC to V0 (0x%02X) + NNN (0x%04X); Result PC = 0x%04X\n",
+               chip8->V[0], chip8->inst.NNN, chip8->V[0] + chip8->inst.NNN);
+        break;
+
+    case OP_CXNN:
+        printf("Set V%X = rand() %% 256 & NN (0x%02X)\n",
+               chip8->inst.X, chip8->inst.NN);
+        break;
+
+    case OP_DXYN:
+        // Screen pixels are XOR'd with sprite bits, VF (Carry flag) is set if any screen pixels are set off
+        printf("Draw N (%u) height sprite at coords V%X (0x%02X), V%X (0x%02X) "
+               "from memory location I (0x%04X). Set VF = 1 if any pixels are turned off.\n",
+               chip8->inst.N, chip8->inst.X, chip8->V[chip8->inst.X], chip8->inst.Y,
+               chip8->V[chip8->inst.Y], chip8->I);
+        break;
+
+    case OP_EX9E:
+        printf("Skip next instruction if key in V%X (0x%02X) is pressed; Keypad value: %d\n",
+               chip8->inst.X, chip8->V[chip8->inst.X], chip8->keypad[chip8->V[chip8->inst.X] & 0xF]);
+        break;
+
+    case OP_EXA1:
+        printf("Skip next instruction if key in V%X (0x%02X) is not pressed; Keypad value: %d\n",
+               chip8->inst.X, chip8->V[chip8->inst.X], chip8->keypad[chip8->V[chip8->inst.X] & 0xF]);
+        break;
+
+    case OP_F002:
+        printf("Load audio pattern from memory at I (0x%04X)\n",
+               chip8->I);
+        break;
+
+    case OP_FX3A:
+        printf("Set audio pitch = V%X (0x%02X)\n",
+               chip8->inst.X, chip8->V[chip8->inst.X]);
+        break;
+
+    case OP_FX0A:
+        printf("Await until a key is pressed; Store key in V%X\n",
+               chip8->inst.X);
+        break;
+
+    case OP_FX1E:
+        // For non-Amiga CHIP8, does not affect VF
+        printf("I (0x%04X) += V%X (0x%02X); Result (I): 0x%04X\n",
+               chip8->I, chip8->inst.X, chip8->V[chip8->inst.X],
+               chip8->I + chip8->V[chip8->inst.X]);
+        break;
+
+    case OP_FX07:
+        printf("Set V%X = delay timer value (0x%02X)\n",
+               chip8->inst.X, chip8->delay_timer);
+        break;
+
+    case OP_FX15:
+        printf("Set delay timer value = V%X (0x%02X)\n",
+               chip8->inst.X, chip8->V[chip8->inst.X]);
+        break;
+
+    case OP_FX18:
+        printf("Set sound timer value = V%X (0x%02X)\n",
+               chip8->inst.X, chip8->V[chip8->inst.X]);
+        break;
+
+    case OP_FX29:
+        printf("Set I to sprite location in memory for character in V%X (0x%02X). Result(VX*5) = (0x%02X)\n",
+               chip8->inst.X, chip8->V[chip8->inst.X], chip8->V[chip8->inst.X] * 5);
+        break;
+
+    case OP_FX33:
+        // I = hundred's place, I+1 = ten's place, I+2 = one's place
+        printf("Store BCD representation of V%X (0x%02X) at memory from I (0x%04X)\n",
+               chip8->inst.X, chip8->V[chip8->inst.X], chip8->I);
+        break;
+
+    case OP_FX55:
+        // SCHIP does not inrement I, CHIP8 does increment I
+        printf("Register dump V0-V%X (0x%02X) inclusive at memory from I (0x%04X)\n",
+               chip8->inst.X, chip8->V[chip8->inst.X], chip8->I);
+        break;
+
+    case OP_FX65:
+        // SCHIP does not inrement I, CHIP8 does increment I
+        printf("Register load V0-V%X (0x%02X) inclusive at memory from I (0x%04X)\n",
+               chip8->inst.X, chip8->V[chip8->inst.X], chip8->I);
+        break;
+
+    default:
+        // Invalid opcode (8XYN, EXNN, FXNN)
+        break;
+    }
+}
+#endif
+
+// Copy "size" bytes from RAM at "address" to "out". RAM wraps at 4KB like every other access; the block is
+// split at the end of RAM into two memcpys (the second one empty unless it wraps) instead of masking per byte.
+void readRam(const chip8_t *chip8, uint16_t address, uint8_t *out, uint8_t size)
+{
+    address &= 0xFFF;
+    const uint16_t head = size < 0x1000 - address ? size : 0x1000 - address;
+    memcpy(out, &chip8->ram[address], head);
+    memcpy(out + head, &chip8->ram[0], size - head);
+}
+
+// Copy "size" bytes from "in" to RAM at "address", wrapping like readRam
+void writeRam(chip8_t *chip8, uint16_t address, const uint8_t *in, uint8_t size)
+{
+    address &= 0xFFF;
+    const uint16_t head = size < 0x1000 - address ? size : 0x1000 - address;
+    memcpy(&chip8->ram[address], in, head);
+    memcpy(&chip8->ram[0], in + head, size - head);
+}
+
+// CXNN random number, xorshift32 kept per machine so runs are reproducible and instances independent
+uint8_t chip8Rand(chip8_t *chip8)
+{
+    uint32_t x = chip8->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    chip8->rng = x;
+    return x >> 24;
+}
+
+// Emulate a single instruction
+void emulateInstruction(chip8_t *chip8, const config_t config)
+{
+#ifdef PROFILE
+    const uint16_t pc = chip8->PC;
+    const uint64_t profile_start = profileTicks();
+#endif
+    // get next opcode from RAM; addresses wrap at 4KB (& 0xFFF) so no access can leave RAM
+    chip8->inst.opcode = (chip8->ram[chip8->PC & 0xFFF] << 8) | chip8->ram[(chip8->PC + 1) & 0xFFF];
+    // pre-increment Program counter
+    chip8->PC += 2;
+    bool carry; // carry flag
+
+    // Fill current instruction opcode
+    chip8->inst.NNN = chip8->inst.opcode & 0x0FFF;
+    chip8->inst.NN = chip8->inst.opcode & 0x0FF;
+    chip8->inst.N = chip8->inst.opcode & 0x0F;
+    chip8->inst.X = (chip8->inst.opcode >> 8) & 0x0F;
+    chip8->inst.Y = (chip8->inst.opcode >> 4) & 0x0F;
+
+#ifdef DEBUG
+    trace_record_t *record = chip8->tracer ? traceBegin(chip8->tracer, chip8) : NULL;
+#endif
+
+    // emulate opcode
+    switch ((chip8->inst.opcode >> 12) & 0x0F)
+    {
+    case 0x00:
+        if (chip8->inst.NN == 0xE0)
+        {
+            // 0x00E0: Clears the screen.
+            memset(&chip8->display[0], false, sizeof chip8->display);
+            chip8->draw = true; // Will update screen on next 60hz tick
+        }
+        else if (chip8->inst.NN == 0xEE)
+        {
+            // 0x00EE: Returns from a subroutine.
+            chip8->PC = chip8->stack[--chip8->sp & 0xF];
+        }
+        else
+        {
+            // Unimplemented/invalid opcode, may be 0xNNN for calling machine code routine for RCA1802
+        }
+        break;
+
+    case 0x01:
+        // 0x1NNN: Jumps to address NNN.
+        chip8->PC = chip8->inst.NNN; // Set program counter so that next opcode is from NNN
+        break;
+
+    case 0x02:
+        // 0x2NNN: Calls subroutine at NNN.
+        chip8->stack[chip8->sp++ & 0xF] = chip8->PC;
+        chip8->PC = chip8->inst.NNN;
+        break;
+
+    case 0x03:
+        // 0x3XNN: Skips the next instruction if VX equals NN (usually the next instruction is a jump to skip a code block).
+        if (chip8->V[chip8->inst.X] == chip8->inst.NN)
+        {
+            chip8->PC += 2;
+        }
+        break;
+
+    case 0x04:
+        // 0x4XNN: Skips the next instruction if VX does not equal NN (usually the next instruction is a jump to skip a code block).
+        if (chip8->V[chip8->inst.X] != chip8->inst.NN)
+        {
+            chip8->PC += 2;
+        }
+        break;
+
+    case 0x05:
+        // 0x5XY0: Skips the next instruction if VX equals VY (usually the next instruction is a jump to skip a code block).
+        if (chip8->inst.N != 0)
+        {
+            break; // Wrong opcode
+        }
+
+        if (chip8->V[chip8->inst.X] == chip8->V[chip8->inst.Y])
+        {
+            chip8->PC += 2; // Skip next opcode/instruction
+        }
+        break;
+
+    case 0x06:
+        // 0x6XNN: Sets VX to NN.
+        chip8->V[chip8->inst.X] = chip8->inst.NN;
+        break;
+
+    case 0x07:
+        // 0x7XNN: Adds NN to VX (carry flag is not changed).
+        chip8->V[chip8->inst.X] += chip8->inst.NN;
+        break;
+
+    case 0x08:
+        switch (chip8->inst.N)
+        {
+            {
+            case 0:
+                // 0x8XY0: Sets VX to the value of VY.
+                chip8->V[chip8->inst.X] = chip8->V[chip8->inst.Y];
+                break;
+
+            case 1:
+                // 0x8XY2: Sets VX to VX or VY. (bitwise OR operation)
+                chip8->V[chip8->inst.X] |= chip8->V[chip8->inst.Y];
+                break;
+
+            case 2:
+                // 0x8XY2: Sets VX to VX and VY. (bitwise AND operation)
+                chip8->V[chip8->inst.X] &= chip8->V[chip8->inst.Y];
+                break;
+
+            case 3:
+                // 0x8XY3: Sets VX to VX xor VY.
+                chip8->V[chip8->inst.X] ^= chip8->V[chip8->inst.Y];
+                break;
+
+            case 4:
+                // 0x8XY4: Adds VY to VX. VF is set to 1 when there's a carry, and to 0 when there is not.
+                carry = ((uint16_t)(chip8->V[chip8->inst.X] + chip8->V[chip8->inst.Y]) > 255);
+
+                chip8->V[chip8->inst.X] += chip8->V[chip8->inst.Y];
+                chip8->V[0xF] = carry;
+                break;
+
+            case 5:
+                // 0x8XY5: VY is subtracted from VX. VF is set to 0 when there's a borrow, and 1 when there is not.
+                carry = (chip8->V[chip8->inst.Y] <= chip8->V[chip8->inst.X]);
+
+                chip8->V[chip8->inst.X] -= chip8->V[chip8->inst.Y];
+                chip8->V[0xF] = carry;
+                break;
+
+            case 6:
+                // 0x8XY6: Stores the least significant bit of VX in VF and then shifts VX to the right by 1.
+                carry = chip8->V[chip8->inst.X] & 1;
+                chip8->V[chip8->inst.X] >>= 1;
+                chip8->V[0xF] = carry;
+                break;
+
+            case 7:
+                // 0x8XY7: Sets VX to VY minus VX. VF is set to 0 when there's a borrow, and 1 when there is not.
+                carry = (chip8->V[chip8->inst.X] <= chip8->V[chip8->inst.Y]);
+
+                chip8->V[chip8->inst.X] = chip8->V[chip8->inst.Y] - chip8->V[chip8->inst.X];
+                chip8->V[0xF] = carry;
+                break;
+
+            case 0xE:
+                // 0x8XYE: Stores the most significant bit of VX in VF and then shifts VX to the left by 1.
+                carry = (chip8->V[chip8->inst.X] & 0x80) >> 7;
+                chip8->V[chip8->inst.X] <<= 1;
+                chip8->V[0xF] = carry;
+                break;
+
+            default:
+                break;
+            }
+        }
+        break;
+
+    case 0x09:
+        // 0x9XY0: Skips the next instruction if VX does not equal VY. (Usually the next instruction is a jump to skip a code block);
+        if (chip8->V[chip8->inst.X] != chip8->V[chip8->inst.Y])
+        {
+            chip8->PC += 2;
+        }
+        break;
+
+    case 0x0A:
+        // 0xANNN: Sets I to the address NNN.
+        chip8->I = chip8->inst.NNN;
+        break;
+
+    case 0x0B:
+        // 0xBNNN: Jump to V0 + NNN
+        chip8->PC = chip8->V[0] + chip8->inst.NNN;
+        break;
+
+    case 0x0C:
+        // 0xCXNN: Sets register VX = rand() % 256 & NN (bitwise AND)
+        chip8->V[chip8->inst.X] = chip8Rand(chip8) & chip8->inst.NN;
+        break;
+
+    case 0x0D:
+    {
+        // 0xDXYN: Draw N-height sprite at coords X,Y; Read from memory location I;
+        //   Screen pixels are XOR'd with sprite bits,
+        //   VF (Carry flag) is set if any screen pixels are set off; This is useful
+        //   for collision detection or other reasons.
+        uint8_t X_coord = chip8->V[chip8->inst.X] % config.window_width;
+        uint8_t Y_coord = chip8->V[chip8->inst.Y] % config.window_height;
+        const uint8_t orig_X = X_coord; // Original X value
+
+        chip8->V[0xF] = 0; // Initialize carry flag to 0
+
+        // Loop over all N rows of the sprite
+        for (uint8_t i = 0; i < chip8->inst.N; i++)
+        {
+            // Get next byte/row of sprite data
+            const uint8_t sprite_data = chip8->ram[(chip8->I + i) & 0xFFF];
+            X_coord = orig_X; // Reset X for next row to draw
+
+            for (int8_t j = 7; j >= 0; j--)
+            {
+                // If sprite pixel/bit is on and display pixel is on, set carry flag
+                bool *pixel = &chip8->display[Y_coord * config.window_width + X_coord];
+                const bool sprite_bit = (sprite_data & (1 << j));
+
+                if (sprite_bit && *pixel)
+                {
+                    chip8->V[0xF] = 1;
+                }
+
+                // XOR display pixel with sprite pixel/bit to set it on or off
+                *pixel ^= sprite_bit;
+
+                // Stop drawing this row if hit right edge of screen
+                if (++X_coord >= config.window_width)
+                    break;
+            }
+
+            // Stop drawing entire sprite if hit bottom edge of screen
+            if (++Y_coord >= config.window_height)
+                break;
+        }
+        chip8->draw = true; // Will update screen on next 60hz tick
+        break;
+    }
+
+    case 0x0E:
+        if (chip8->inst.NN == 0x9E)
+        {
+            // 0xEX9E: Skips the next instruction if the key stored in VX is pressed (usually the next instruction is a jump to skip a code block).
+            if (chip8->keypad[chip8->V[chip8->inst.X] & 0xF])
+                chip8->PC += 2;
+        }
+        else if (chip8->inst.NN == 0xA1)
+        {
+            // 0xEX9E: Skips the next instruction if the key stored in VX is not pressed (usually the next instruction is a jump to skip a code block).
+            if (!chip8->keypad[chip8->V[chip8->inst.X] & 0xF])
+                chip8->PC += 2;
+        }
+        break;
+
+    case 0x0F:
+        switch (chip8->inst.NN)
+        {
+        case 0x0A:
+        {
+            // 0xFX0A: A key press is awaited, and then stored in VX (blocking operation, all instruction halted until next key event).
+            for (uint8_t i = 0; chip8->await_key == 0xFF && i < sizeof chip8->keypad; i++)
+                if (chip8->keypad[i])
+                {
+                    chip8->await_key = i; // Save pressed key to check until it is released
+                    break;
+                }
+
+            // If no key has been pressed yet, keep getting the current opcode & running this instruction
+            if (chip8->await_key == 0xFF)
+                chip8->PC -= 2;
+            else
+            {
+                // A key has been pressed, also wait until it is released to set the key in VX
+                if (chip8->keypad[chip8->await_key]) // "Busy loop" until key is released
+                    chip8->PC -= 2;
+                else
+                {
+                    chip8->V[chip8->inst.X] = chip8->await_key; // VX = key
+                    chip8->await_key = 0xFF;                    // Reset key to not found
+                }
+            }
+            break;
+        }
+
+        case 0x02:
+            // 0xF002: XO-CHIP, loads the 16 byte (128 1-bit samples) audio pattern buffer from memory starting at I.
+            if (chip8->inst.X != 0)
+                break; // Wrong opcode
+            readRam(chip8, chip8->I, chip8->pattern, sizeof chip8->pattern);
+            break;
+
+        case 0x3A:
+            // 0xFX3A: XO-CHIP, sets the audio pattern playback pitch to VX.
+            chip8->pitch = chip8->V[chip8->inst.X];
+            break;
+
+        case 0x1E:
+            // 0xFX1E: Adds VX to I. VF is not affected.
+            chip8->I += chip8->V[chip8->inst.X];
+            break;
+
+        case 0x07:
+            // 0xFX07: Sets VX to the value of the delay timer.
+            chip8->V[chip8->inst.X] = chip8->delay_timer;
+            break;
+
+        case 0x15:
+            // 0xFX15: Sets VX to the value of the delay timer.
+            chip8->delay_timer = chip8->V[chip8->inst.X];
+            break;
+
+        case 0x18:
+            // 0xFX18: Sets the sound timer to VX.
+            chip8->sound_timer = chip8->V[chip8->inst.X];
+            break;
+
+        case 0x29:
+            // 0xFX29: Sets I to the location of the sprite for the character in VX. Characters 0-F (in hexadecimal) are represented by a 4x5 font.
+            chip8->I = chip8->V[chip8->inst.X] * 5;
+            break;
+
+        case 0x33:
+        {
+            // 0xFX33: Stores the binary-coded decimal representation of VX,
+            // with the hundreds digit in memory at location in I, the tens digit at location I+1,
+            // and the ones digit at location I+2.
+            uint8_t bcd = chip8->V[chip8->inst.X];
+            chip8->ram[(chip8->I + 2) & 0xFFF] = bcd % 10;
+            bcd /= 10;
+            chip8->ram[(chip8->I + 1) & 0xFFF] = bcd % 10;
+            bcd /= 10;
+            chip8->ram[chip8->I & 0xFFF] = bcd;
+            break;
+        }
+
+        case 0x55:
+            // 0xFX55: Stores from V0 to VX (including VX) in memory, starting at address I. 
+            // The offset from I is increased by 1 for each value written, but I itself is left unmodified.
+            writeRam(chip8, chip8->I, chip8->V, chip8->inst.X + 1);
+            break;
+
+        case 0x65:
+            // 0xFX65: Fills from V0 to VX (including VX) with values from memory, starting at address I. 
+            // The offset from I is increased by 1 for each value read, but I itself is left unmodified
+            readRam(chip8, chip8->I, chip8->V, chip8->inst.X + 1);
+            break;
+
+        default:
+            break;
+        }
+        break;
+
+    default:
+        break;
+    }
+
+#ifdef DEBUG
+    if (record)
+        traceEnd(chip8->tracer, record, chip8);
+#endif
+#ifdef PROFILE
+    if (chip8->profile)
+        profileInstruction(chip8->profile, pc, chip8->inst.opcode, chip8->PC, profileTicks() - profile_start);
+#endif
+}
+
+// Update CHIP8 delay & sound timers, called at 60Hz
+void updateTimers(chip8_t *chip8)
+{
+    if (chip8->delay_timer > 0)
+        chip8->delay_timer--;
+    if (chip8->sound_timer > 0)
+        chip8->sound_timer--;
+}
+
+// Emulate one 60Hz frame worth of instructions, then tick the timers.
+// Audio changes are forwarded to the synthesizer at the sample position of the instruction that made them.
+void emulateFrame(chip8_t *chip8, const config_t config, audio_t *audio)
+{
+    const uint32_t insts = config.insts_per_second / 60 ? config.insts_per_second / 60 : 1;
+    uint64_t start = 0, len = 0;
+    if (audio)
+    {
+        syncAudio(audio);
+        start = frameSample(audio, audio->frames);
+        len = frameSample(audio, audio->frames + 1) - start;
+    }
+
+    for (uint32_t i = 0; i < insts; i++)
+    {
+        emulateInstruction(chip8, config);
+
+        // F002 (pattern), FX3A (pitch), FX18 (sound timer) change audio output
+        if (audio && (chip8->inst.opcode & 0xF000) == 0xF000 &&
+            (chip8->inst.NN == 0x02 || chip8->inst.NN == 0x3A || chip8->inst.NN == 0x18))
+            pushAudioEvent(audio, start + len * (i + 1) / insts, chip8->pattern, chip8->pitch, chip8->sound_timer > 0);
+    }
+
+    const bool beeping = chip8->sound_timer > 0;
+    updateTimers(chip8);
+    if (audio)
+    {
+        if (beeping && chip8->sound_timer == 0)
+            pushAudioEvent(audio, start + len, chip8->pattern, chip8->pitch, false); // sound timer ran out
+        audio->frames++;
+    }
+}
+
+// FNV-1a hash of emulated machine state (memory, display, stack, registers, timers), for comparing runs
+uint64_t hashChip8(const chip8_t *chip8)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    const auto mix = [&hash](const void *data, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+            hash = (hash ^ ((const uint8_t *)data)[i]) * 0x100000001B3ull;
+    };
+    // 16-bit registers mixed byte by byte so hashes match across hosts
+    const uint8_t regs[] = {
+        (uint8_t)(chip8->I & 0xFF), (uint8_t)(chip8->I >> 8),
+        (uint8_t)(chip8->PC & 0xFF), (uint8_t)(chip8->PC >> 8),
+        chip8->delay_timer, chip8->sound_timer,
+        chip8->sp, // stack depth
+        (uint8_t)(chip8->rng & 0xFF), (uint8_t)(chip8->rng >> 8),
+        (uint8_t)(chip8->rng >> 16), (uint8_t)(chip8->rng >> 24),
+    };
+
+    mix(chip8->ram, sizeof chip8->ram);
+    mix(chip8->display, sizeof chip8->display);
+    for (uint16_t address : chip8->stack)
+    {
+        const uint8_t bytes[] = {(uint8_t)(address & 0xFF), (uint8_t)(address >> 8)};
+        mix(bytes, sizeof bytes);
+    }
+    mix(chip8->V, sizeof chip8->V);
+    mix(regs, sizeof regs);
+    return hash;
+}
+
+// Display packed 1 bit per pixel, row major, leftmost pixel in bit 7 (8 bytes per row), for capture and streaming
+void packDisplay(const chip8_t *chip8, uint8_t packed[sizeof chip8->display / 8])
+{
+    for (uint32_t i = 0; i < sizeof chip8->display / 8; i++)
+    {
+        const bool *p = &chip8->display[8 * i];
+        packed[i] = p[0] << 7 | p[1] << 6 | p[2] << 5 | p[3] << 4 | p[4] << 3 | p[5] << 2 | p[6] << 1 | p[7];
+    }
+}
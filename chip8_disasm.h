@@ -0,0 +1,351 @@
+#pragma once
+#include <stdio.h>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#include "chip8_opcodes.h"
+
+// Static disassembler: recursive traversal from 0x200 following jumps, calls and both sides of skips.
+// BNNN jumps are recorded as indirect, their targets are not followed. Bytes never reached as
+// code are data. The result is split into basic blocks with a control flow graph, functions (0x200 and call
+// targets, with the blocks reachable from them without entering calls) and a call graph.
+#define DISASM_ENTRY 0x200
+
+typedef enum
+{
+    BYTE_UNKNOWN, // not reached (data)
+    BYTE_CODE,    // first byte of an instruction
+    BYTE_OPERAND, // second byte of an instruction
+} byte_kind_t;
+
+typedef enum
+{
+    EDGE_FALLTHROUGH, // next block, no branch
+    EDGE_JUMP,        // 1NNN
+    EDGE_SKIP,        // skip taken
+    EDGE_RETURN,      // after a 2NNN call returns
+} edge_kind_t;
+
+typedef struct
+{
+    uint16_t start, end; // instruction addresses [start, end)
+    uint16_t function;   // entry of the function owning the block
+} block_t;
+
+typedef struct
+{
+    uint16_t from, to; // block starts
+    edge_kind_t kind;
+} edge_t;
+
+typedef struct
+{
+    uint16_t site;   // 2NNN address
+    uint16_t caller; // function entries
+    uint16_t callee;
+} call_t;
+
+typedef struct
+{
+    uint8_t ram[4096];
+    uint16_t rom_end; // one past the last ROM byte
+    uint8_t kind[4096];
+    bool leader[4096];   // basic block starts
+    bool function[4096]; // function entries
+    bool data_ref[4096]; // ANNN targets
+    std::vector<uint16_t> indirect; // BNNN addresses
+    std::vector<block_t> blocks;    // by address
+    std::vector<edge_t> edges;
+    std::vector<call_t> calls;
+    uint32_t instructions;
+} disasm_t;
+
+uint16_t disasmOpcode(const disasm_t *disasm, uint16_t addr)
+{
+    return (disasm->ram[addr] << 8) | disasm->ram[addr + 1];
+}
+
+bool inRom(const disasm_t *disasm, uint16_t addr)
+{
+    return addr >= DISASM_ENTRY && addr + 2 <= disasm->rom_end;
+}
+
+// Index of the block starting at "addr", -1 if none
+int findBlock(const disasm_t *disasm, uint16_t addr)
+{
+    const auto it = std::lower_bound(disasm->blocks.begin(), disasm->blocks.end(), addr,
+                                     [](const block_t &block, uint16_t a)
+                                     { return block.start < a; });
+    return it != disasm->blocks.end() && it->start == addr ? (int)(it - disasm->blocks.begin()) : -1;
+}
+
+// Mark every instruction reachable from 0x200
+void traceCode(disasm_t *disasm)
+{
+    std::vector<uint16_t> work = {DISASM_ENTRY};
+    disasm->leader[DISASM_ENTRY] = true;
+    disasm->function[DISASM_ENTRY] = true;
+
+    const auto branch = [&](uint16_t target)
+    {
+        if (!inRom(disasm, target))
+            return;
+        disasm->leader[target] = true;
+        work.push_back(target);
+    };
+
+    while (!work.empty())
+    {
+        uint16_t addr = work.back();
+        work.pop_back();
+        while (inRom(disasm, addr) && disasm->kind[addr] != BYTE_CODE)
+        {
+            disasm->kind[addr] = BYTE_CODE;
+            disasm->kind[addr + 1] = BYTE_OPERAND;
+            disasm->instructions++;
+
+            const uint16_t opcode = disasmOpcode(disasm, addr);
+            const opcode_class_t op = opcodeClass(opcode);
+            if (op == OP_ANNN)
+                disasm->data_ref[opcode & 0xFFF] = true;
+
+            bool next = true;
+            switch (opcode_info[op].flow)
+            {
+            case FLOW_JUMP:
+                branch(opcode & 0xFFF);
+                next = false;
+                break;
+            case FLOW_CALL:
+                if (inRom(disasm, opcode & 0xFFF))
+                    disasm->function[opcode & 0xFFF] = true;
+                branch(opcode & 0xFFF);
+                disasm->leader[(addr + 2) & 0xFFF] = true;
+                break;
+            case FLOW_SKIP:
+                branch(addr + 4);
+                disasm->leader[(addr + 2) & 0xFFF] = true;
+                break;
+            case FLOW_INDIRECT:
+                disasm->indirect.push_back(addr);
+                next = false;
+                break;
+            case FLOW_RETURN:
+                next = false;
+                break;
+            default:
+                break;
+            }
+            if (!next)
+                break;
+            addr += 2;
+        }
+    }
+}
+
+// Split traced code into basic blocks and connect them
+void buildBlocks(disasm_t *disasm)
+{
+    for (uint16_t addr = DISASM_ENTRY; addr < disasm->rom_end; addr++)
+    {
+        if (disasm->kind[addr] != BYTE_CODE || (!disasm->leader[addr] && addr >= 2 && disasm->kind[addr - 2] == BYTE_CODE &&
+                                                 opcode_info[opcodeClass(disasmOpcode(disasm, addr - 2))].flow == FLOW_NEXT))
+            continue; // not a block start: mid block, or data
+
+        // Block runs until a branch, a leader or the end of the traced code
+        block_t block = {addr, addr, 0};
+        uint16_t last;
+        do
+        {
+            last = block.end;
+            block.end += 2;
+        } while (opcode_info[opcodeClass(disasmOpcode(disasm, last))].flow == FLOW_NEXT && inRom(disasm, block.end) &&
+                 disasm->kind[block.end] == BYTE_CODE && !disasm->leader[block.end]);
+        disasm->blocks.push_back(block);
+        disasm->leader[addr] = true;
+    }
+
+    for (const block_t &block : disasm->blocks)
+    {
+        const uint16_t last = block.end - 2;
+        const uint16_t opcode = disasmOpcode(disasm, last);
+        const auto edge = [&](uint16_t to, edge_kind_t kind)
+        {
+            if (inRom(disasm, to) && disasm->kind[to] == BYTE_CODE)
+                disasm->edges.push_back({block.start, to, kind});
+        };
+        switch (opcode_info[opcodeClass(opcode)].flow)
+        {
+        case FLOW_NEXT:
+            edge(block.end, EDGE_FALLTHROUGH);
+            break;
+        case FLOW_JUMP:
+            edge(opcode & 0xFFF, EDGE_JUMP);
+            break;
+        case FLOW_CALL:
+            edge(block.end, EDGE_RETURN);
+            break;
+        case FLOW_SKIP:
+            edge(block.end, EDGE_FALLTHROUGH);
+            edge(block.end + 2, EDGE_SKIP);
+            break;
+        default:
+            break; // returns and indirect jumps have no static successors
+        }
+    }
+}
+
+// Give every block a function (first entry, by address, to reach it) and collect calls between functions
+void buildFunctions(disasm_t *disasm)
+{
+    std::vector<bool> owned(disasm->blocks.size(), false);
+    for (uint16_t entry = DISASM_ENTRY; entry < disasm->rom_end; entry++)
+    {
+        const int first = disasm->function[entry] ? findBlock(disasm, entry) : -1;
+        if (first < 0 || owned[first])
+            continue;
+        std::vector<int> work = {first};
+        owned[first] = true;
+        while (!work.empty())
+        {
+            block_t *block = &disasm->blocks[work.back()];
+            work.pop_back();
+            block->function = entry;
+            for (const edge_t &edge : disasm->edges)
+            {
+                const int to = edge.from == block->start ? findBlock(disasm, edge.to) : -1;
+                if (to >= 0 && !owned[to])
+                {
+                    owned[to] = true;
+                    work.push_back(to);
+                }
+            }
+        }
+    }
+
+    for (const block_t &block : disasm->blocks)
+    {
+        const uint16_t opcode = disasmOpcode(disasm, block.end - 2);
+        if (opcodeClass(opcode) == OP_2NNN && inRom(disasm, opcode & 0xFFF))
+            disasm->calls.push_back({(uint16_t)(block.end - 2), block.function, (uint16_t)(opcode & 0xFFF)});
+    }
+}
+
+// Disassemble a ROM image loaded at 0x200
+bool disassemble(disasm_t *disasm, const uint8_t *rom, size_t size)
+{
+    memset(disasm->ram, 0, sizeof disasm->ram);
+    memset(disasm->kind, BYTE_UNKNOWN, sizeof disasm->kind);
+    memset(disasm->leader, 0, sizeof disasm->leader);
+    memset(disasm->function, 0, sizeof disasm->function);
+    memset(disasm->data_ref, 0, sizeof disasm->data_ref);
+    disasm->indirect.clear();
+    disasm->blocks.clear();
+    disasm->edges.clear();
+    disasm->calls.clear();
+    disasm->instructions = 0;
+    if (size > sizeof disasm->ram - DISASM_ENTRY)
+        return false;
+
+    memcpy(&disasm->ram[DISASM_ENTRY], rom, size);
+    disasm->rom_end = DISASM_ENTRY + size;
+    traceCode(disasm);
+    buildBlocks(disasm);
+    buildFunctions(disasm);
+    return true;
+}
+
+// Listing: labels, instructions with their description, data as byte rows
+void printListing(const disasm_t *disasm, FILE *out)
+{
+    uint32_t code = 0;
+    for (uint16_t addr = DISASM_ENTRY; addr < disasm->rom_end; addr++)
+        code += disasm->kind[addr] != BYTE_UNKNOWN;
+    fprintf(out, "; %u instructions, %zu blocks, %zu calls, %zu indirect jumps, %u code bytes, %u data bytes\n",
+            disasm->instructions, disasm->blocks.size(), disasm->calls.size(), disasm->indirect.size(), code,
+            disasm->rom_end - DISASM_ENTRY - code);
+
+    for (uint16_t addr = DISASM_ENTRY; addr < disasm->rom_end;)
+    {
+        if (disasm->kind[addr] == BYTE_CODE)
+        {
+            if (disasm->function[addr])
+                fprintf(out, "\nsub_%03X:\n", addr);
+            else if (disasm->leader[addr])
+                fprintf(out, "loc_%03X:\n", addr);
+
+            const uint16_t opcode = disasmOpcode(disasm, addr);
+            char text[32];
+            formatOpcode(opcode, text, sizeof text);
+            fprintf(out, "    %03X  %04X  %-18s ; %s%s\n", addr, opcode, text, opcode_info[opcodeClass(opcode)].description,
+                    opcode_info[opcodeClass(opcode)].flow == FLOW_INDIRECT ? " (indirect, not followed)" : "");
+            addr += 2;
+            continue;
+        }
+
+        // Data row: up to 8 bytes, broken at code and at referenced addresses
+        if (disasm->data_ref[addr])
+            fprintf(out, "data_%03X:\n", addr);
+        fprintf(out, "    %03X        db ", addr);
+        uint8_t n = 0;
+        do
+        {
+            fprintf(out, "%s0x%02X", n ? ", " : "", disasm->ram[addr]);
+            addr++;
+            n++;
+        } while (n < 8 && addr < disasm->rom_end && disasm->kind[addr] == BYTE_UNKNOWN && !disasm->data_ref[addr]);
+        fprintf(out, "\n");
+    }
+
+    fprintf(out, "\n; call graph\n");
+    for (const call_t &call : disasm->calls)
+        fprintf(out, ";   sub_%03X -> sub_%03X (at %03X)\n", call.caller, call.callee, call.site);
+}
+
+// Control flow graph in Graphviz DOT, one cluster per function
+void printCfgDot(const disasm_t *disasm, FILE *out)
+{
+    fprintf(out, "digraph cfg {\n    node [shape=box fontname=monospace];\n");
+    for (uint16_t entry = DISASM_ENTRY; entry < disasm->rom_end; entry++)
+    {
+        if (!disasm->function[entry])
+            continue;
+        fprintf(out, "    subgraph cluster_%03X {\n        label=\"sub_%03X\";\n", entry, entry);
+        for (const block_t &block : disasm->blocks)
+        {
+            if (block.function != entry)
+                continue;
+            fprintf(out, "        b%03X [label=\"", block.start);
+            for (uint16_t addr = block.start; addr < block.end; addr += 2)
+            {
+                char text[32];
+                formatOpcode(disasmOpcode(disasm, addr), text, sizeof text);
+                fprintf(out, "%03X  %s\\l", addr, text);
+            }
+            fprintf(out, "\"];\n");
+        }
+        fprintf(out, "    }\n");
+    }
+    const char *styles[] = {"", " [style=bold]", " [label=skip color=blue]", " [style=dashed]"};
+    for (const edge_t &edge : disasm->edges)
+        fprintf(out, "    b%03X -> b%03X%s;\n", edge.from, edge.to, styles[edge.kind]);
+    for (uint16_t addr : disasm->indirect)
+        for (const block_t &block : disasm->blocks)
+            if (addr >= block.start && addr < block.end)
+                fprintf(out, "    i%03X [shape=diamond label=\"V0 + %03X\"];\n    b%03X -> i%03X [style=dotted];\n", addr,
+                        disasmOpcode(disasm, addr) & 0xFFF, block.start, addr);
+    fprintf(out, "}\n");
+}
+
+// Call graph in Graphviz DOT
+void printCallDot(const disasm_t *disasm, FILE *out)
+{
+    fprintf(out, "digraph calls {\n    node [shape=box fontname=monospace];\n");
+    for (uint16_t entry = DISASM_ENTRY; entry < disasm->rom_end; entry++)
+        if (disasm->function[entry] && findBlock(disasm, entry) >= 0)
+            fprintf(out, "    sub_%03X;\n", entry);
+    for (const call_t &call : disasm->calls)
+        fprintf(out, "    sub_%03X -> sub_%03X;\n", call.caller, call.callee);
+    fprintf(out, "}\n");
+}
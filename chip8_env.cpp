@@ -0,0 +1,240 @@
+#include <stdio.h>
+#include <cstdlib>
+
+#include "chip8_core.h"
+#include "chip8_fork.h"
+#include "chip8_input.h"
+#include "chip8_env.h"
+
+#define ENV_MAX_PROBES 16
+
+// RAM address probe, read after every step
+typedef struct
+{
+    uint16_t addr;
+    chip8_probe_t kind;
+    float scale;    // reward probes
+    uint32_t value; // done probes
+} probe_t;
+
+struct chip8_env
+{
+    uint32_t n;
+    config_t config;
+    uint32_t frame_skip;
+    uint32_t max_frames;
+    uint32_t seed;
+    uint32_t episodes; // episodes started since the last env_reset, per episode seed
+    fork_server_t fork; // booted machine snapshot, instances are copy-on-write clones of it
+    chip8_t **machines; // n
+    uint32_t *frames;   // n, frames into the current episode
+    uint32_t *previous; // n x reward probes, probe values before the step
+    uint8_t *obs;       // n x 32 x 64
+    float *rewards;     // n
+    uint8_t *dones;     // n
+
+    probe_t reward_probes[ENV_MAX_PROBES];
+    uint32_t reward_count;
+    probe_t done_probes[ENV_MAX_PROBES];
+    uint32_t done_count;
+};
+
+uint32_t readProbe(const chip8_t *chip8, const probe_t *probe)
+{
+    const uint8_t *ram = chip8->ram;
+    const uint16_t addr = probe->addr;
+    switch (probe->kind)
+    {
+    case CHIP8_PROBE_U16:
+        return (ram[addr] << 8) | ram[(addr + 1) & 0xFFF];
+    case CHIP8_PROBE_BCD:
+        return ram[addr] * 100 + ram[(addr + 1) & 0xFFF] * 10 + ram[(addr + 2) & 0xFFF];
+    default:
+        return ram[addr];
+    }
+}
+
+// Copy instance display into its slot of the observation buffer
+void writeObservation(chip8_env_t *env, uint32_t i)
+{
+    memcpy(&env->obs[(size_t)i * sizeof env->machines[i]->display], env->machines[i]->display, sizeof env->machines[i]->display);
+}
+
+// Start a new episode on instance i, false (instance untouched) if no clone could be mapped
+bool resetInstance(chip8_env_t *env, uint32_t i)
+{
+    if (!forkReset(&env->fork, &env->machines[i])) // swap in a pristine clone
+        return false;
+    seedChip8(env->machines[i], env->seed + env->episodes++); // clones share the snapshot's CXNN state
+    env->frames[i] = 0;
+    for (uint32_t p = 0; p < env->reward_count; p++)
+        env->previous[i * ENV_MAX_PROBES + p] = readProbe(env->machines[i], &env->reward_probes[p]);
+    writeObservation(env, i);
+    return true;
+}
+
+chip8_env_t *env_create(const char *rom, uint32_t n)
+{
+    if (n == 0)
+        return NULL;
+
+    // Boot once, every instance and reset after that is a clone of this machine
+    chip8_t boot = {};
+    if (!initChip8(&boot, rom))
+        return NULL;
+    boot.rom_name = NULL; // caller's string may not outlive the environment
+
+    chip8_env_t *env = (chip8_env_t *)calloc(1, sizeof *env);
+    if (!env)
+        return NULL;
+    if (!initForkServer(&env->fork, &boot))
+    {
+        free(env);
+        return NULL;
+    }
+
+    char *args[] = {NULL};
+    setupEmulator(&env->config, 0, args); // default emulator config
+    env->frame_skip = 4;
+    env->machines = (chip8_t **)calloc(n, sizeof *env->machines);
+    env->frames = (uint32_t *)calloc(n, sizeof *env->frames);
+    env->previous = (uint32_t *)calloc((size_t)n * ENV_MAX_PROBES, sizeof *env->previous);
+    env->obs = (uint8_t *)calloc(n, sizeof boot.display);
+    env->rewards = (float *)calloc(n, sizeof *env->rewards);
+    env->dones = (uint8_t *)calloc(n, sizeof *env->dones);
+    if (!env->machines || !env->frames || !env->previous || !env->obs || !env->rewards || !env->dones)
+    {
+        env_destroy(env); // n still 0, frees the buffers that were allocated
+        return NULL;
+    }
+    env->n = n;
+    if (env_reset(env) != 0) // every instance needs its first clone
+    {
+        env_destroy(env);
+        return NULL;
+    }
+    return env;
+}
+
+void env_destroy(chip8_env_t *env)
+{
+    if (!env)
+        return;
+    for (uint32_t i = 0; i < env->n; i++)
+        forkRelease(&env->fork, env->machines[i]);
+    freeForkServer(&env->fork);
+    free(env->machines);
+    free(env->frames);
+    free(env->previous);
+    free(env->obs);
+    free(env->rewards);
+    free(env->dones);
+    free(env);
+}
+
+void env_set_frame_skip(chip8_env_t *env, uint32_t frames)
+{
+    env->frame_skip = frames ? frames : 1;
+}
+
+void env_set_ips(chip8_env_t *env, uint32_t insts_per_second)
+{
+    env->config.insts_per_second = insts_per_second;
+}
+
+void env_set_max_frames(chip8_env_t *env, uint32_t frames)
+{
+    env->max_frames = frames;
+}
+
+void env_seed(chip8_env_t *env, uint32_t seed)
+{
+    env->seed = seed;
+}
+
+int env_add_reward_probe(chip8_env_t *env, uint16_t addr, chip8_probe_t kind, float scale)
+{
+    if (env->reward_count == ENV_MAX_PROBES || addr >= sizeof env->machines[0]->ram)
+        return -1;
+    env->reward_probes[env->reward_count] = (probe_t){.addr = addr, .kind = kind, .scale = scale, .value = 0};
+    for (uint32_t i = 0; i < env->n; i++)
+        env->previous[i * ENV_MAX_PROBES + env->reward_count] = readProbe(env->machines[i], &env->reward_probes[env->reward_count]);
+    return env->reward_count++;
+}
+
+int env_add_done_probe(chip8_env_t *env, uint16_t addr, chip8_probe_t kind, uint32_t value)
+{
+    if (env->done_count == ENV_MAX_PROBES || addr >= sizeof env->machines[0]->ram)
+        return -1;
+    env->done_probes[env->done_count] = (probe_t){.addr = addr, .kind = kind, .scale = 0, .value = value};
+    return env->done_count++;
+}
+
+int env_reset(chip8_env_t *env)
+{
+    env->episodes = 0;
+    for (uint32_t i = 0; i < env->n; i++)
+    {
+        if (!resetInstance(env, i))
+            return -1;
+        env->rewards[i] = 0;
+        env->dones[i] = 0;
+    }
+    return 0;
+}
+
+int env_step(chip8_env_t *env, const uint16_t *actions)
+{
+    int result = 0;
+    for (uint32_t i = 0; i < env->n; i++)
+    {
+        chip8_t *chip8 = env->machines[i];
+        setKeypad(chip8, actions ? actions[i] : 0);
+        for (uint32_t f = 0; f < env->frame_skip && chip8->state == RUNNING; f++)
+            emulateFrame(chip8, env->config, NULL);
+        env->frames[i] += env->frame_skip;
+
+        float reward = 0;
+        for (uint32_t p = 0; p < env->reward_count; p++)
+        {
+            const uint32_t value = readProbe(chip8, &env->reward_probes[p]);
+            reward += env->reward_probes[p].scale * ((float)value - (float)env->previous[i * ENV_MAX_PROBES + p]);
+            env->previous[i * ENV_MAX_PROBES + p] = value;
+        }
+
+        bool done = chip8->state != RUNNING || (env->max_frames && env->frames[i] >= env->max_frames);
+        for (uint32_t p = 0; p < env->done_count && !done; p++)
+            done = readProbe(chip8, &env->done_probes[p]) == env->done_probes[p].value;
+
+        env->rewards[i] = reward;
+        env->dones[i] = done;
+        if (!done)
+            writeObservation(env, i);
+        else if (!resetInstance(env, i)) // auto reset, observation starts the next episode
+        {
+            writeObservation(env, i); // keeps the finished episode, reset again when it next finishes
+            result = -1;
+        }
+    }
+    return result;
+}
+
+uint32_t env_count(const chip8_env_t *env)
+{
+    return env->n;
+}
+
+const uint8_t *env_observations(const chip8_env_t *env)
+{
+    return env->obs;
+}
+
+const float *env_rewards(const chip8_env_t *env)
+{
+    return env->rewards;
+}
+
+const uint8_t *env_dones(const chip8_env_t *env)
+{
+    return env->dones;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <stdint.h>
+
+// Batched CHIP8 environment, C ABI for RL frameworks (ctypes/cffi/C). Built as a shared library by "make env".
+//
+//   chip8_env_t *env = env_create("roms/game.ch8", 64);
+//   env_add_reward_probe(env, 0x2F0, CHIP8_PROBE_BCD, 1.0f); // score stored by FX33 at 0x2F0
+//   env_reset(env);
+//   const uint8_t *obs = env_observations(env);               // n x 32 x 64, 0/1 per pixel
+//   env_step(env, actions);                                   // one keypad bit mask per instance
+//   rewards = env_rewards(env); dones = env_dones(env);
+//
+// Observation, reward and done buffers are owned by the environment and updated in place by every step.
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if defined(_WIN32)
+#define CHIP8_ENV_API __declspec(dllexport)
+#else
+#define CHIP8_ENV_API __attribute__((visibility("default")))
+#endif
+
+    typedef struct chip8_env chip8_env_t;
+
+    // RAM probe value decoding
+    typedef enum
+    {
+        CHIP8_PROBE_U8,  // ram[addr]
+        CHIP8_PROBE_U16, // ram[addr] << 8 | ram[addr + 1]
+        CHIP8_PROBE_BCD, // ram[addr] * 100 + ram[addr + 1] * 10 + ram[addr + 2], as written by FX33
+    } chip8_probe_t;
+
+    // Boot "n" instances of "rom", NULL if the ROM can't be loaded
+    CHIP8_ENV_API chip8_env_t *env_create(const char *rom, uint32_t n);
+    CHIP8_ENV_API void env_destroy(chip8_env_t *env);
+
+    // Emulated 60Hz frames per step (default 4) and instructions per second (default 700)
+    CHIP8_ENV_API void env_set_frame_skip(chip8_env_t *env, uint32_t frames);
+    CHIP8_ENV_API void env_set_ips(chip8_env_t *env, uint32_t insts_per_second);
+    // End an episode after this many frames, 0 = never (default)
+    CHIP8_ENV_API void env_set_max_frames(chip8_env_t *env, uint32_t frames);
+    // CXNN random numbers: every episode of every instance gets its own stream derived from "seed" (default 0).
+    // Takes effect from the next env_reset.
+    CHIP8_ENV_API void env_seed(chip8_env_t *env, uint32_t seed);
+
+    // Reward += scale * (probe value after step - probe value before step), probes are summed
+    CHIP8_ENV_API int env_add_reward_probe(chip8_env_t *env, uint16_t addr, chip8_probe_t kind, float scale);
+    // Episode done when probe value == value
+    CHIP8_ENV_API int env_add_done_probe(chip8_env_t *env, uint16_t addr, chip8_probe_t kind, uint32_t value);
+
+    // Reset every instance to the boot state, 0 or -1 if an instance could not be reset (out of memory)
+    CHIP8_ENV_API int env_reset(chip8_env_t *env);
+    // Hold actions[i] (keypad bit mask, bit N = key N) on instance i for one step. Instances that finish
+    // an episode report done and are reset, their observation is the first frame of the next episode.
+    // Returns 0, or -1 if a finished instance could not be reset; it keeps its last frame and is reset
+    // again when it next finishes.
+    CHIP8_ENV_API int env_step(chip8_env_t *env, const uint16_t *actions);
+
+    CHIP8_ENV_API uint32_t env_count(const chip8_env_t *env);
+    CHIP8_ENV_API const uint8_t *env_observations(const chip8_env_t *env); // n x 32 x 64 bytes
+    CHIP8_ENV_API const float *env_rewards(const chip8_env_t *env);        // n
+    CHIP8_ENV_API const uint8_t *env_dones(const chip8_env_t *env);        // n
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,195 @@
+#pragma once
+#include <stdio.h>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "chip8_core.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Fork server: one booted machine snapshot in shared memory, clones are private copy-on-write mappings of it.
+// Clones share every page they have not written (font, untouched ROM, ...), the OS allocates a private
+// page on first write. Reset swaps a dirty clone for a pristine one; dirty clones are restored in batches by
+// dropping their private pages, no memcpy or ROM file I/O.
+typedef struct
+{
+    size_t size; // snapshot size, sizeof(chip8_t) rounded up to whole pages
+#if defined(_WIN32)
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+    chip8_t **spares; // pristine clones, handed out by forkReset
+    uint32_t spare_count;
+    chip8_t **dirty; // reset clones waiting to be restored
+    uint32_t dirty_count;
+    uint32_t capacity; // spares/dirty array size
+} fork_server_t;
+
+// Snapshot "boot" (e.g. straight after initChip8) into shared memory. Clones made afterwards start from it.
+bool initForkServer(fork_server_t *server, const chip8_t *boot)
+{
+    memset(server, 0, sizeof *server);
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    const size_t page = info.dwAllocationGranularity;
+#else
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+#endif
+    server->size = (sizeof(chip8_t) + page - 1) / page * page;
+
+#if defined(_WIN32)
+    server->mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, (DWORD)server->size, NULL);
+    if (!server->mapping)
+    {
+        std::cout << "Could not create fork server snapshot\n";
+        return false;
+    }
+    void *snapshot = MapViewOfFile(server->mapping, FILE_MAP_WRITE, 0, 0, server->size);
+    if (!snapshot)
+    {
+        std::cout << "Could not create fork server snapshot\n";
+        CloseHandle(server->mapping);
+        return false;
+    }
+    memcpy(snapshot, boot, sizeof *boot);
+    UnmapViewOfFile(snapshot);
+#else
+#if defined(__linux__)
+    server->fd = memfd_create("chip8-snapshot", 0);
+#else
+    char name[64];
+    snprintf(name, sizeof name, "/chip8-snapshot-%d", (int)getpid());
+    server->fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    shm_unlink(name); // keep only the descriptor
+#endif
+    void *snapshot = MAP_FAILED;
+    if (server->fd >= 0 && ftruncate(server->fd, server->size) == 0)
+        snapshot = mmap(NULL, server->size, PROT_READ | PROT_WRITE, MAP_SHARED, server->fd, 0);
+    if (snapshot == MAP_FAILED)
+    {
+        std::cout << "Could not create fork server snapshot\n";
+        if (server->fd >= 0)
+            close(server->fd);
+        return false;
+    }
+    memcpy(snapshot, boot, sizeof *boot);
+    munmap(snapshot, server->size);
+#endif
+    return true;
+}
+
+// Map a new private copy-on-write view of the snapshot
+chip8_t *mapClone(fork_server_t *server)
+{
+#if defined(_WIN32)
+    chip8_t *clone = (chip8_t *)MapViewOfFile(server->mapping, FILE_MAP_COPY, 0, 0, server->size);
+    if (!clone)
+        return NULL;
+#else
+    void *view = mmap(NULL, server->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, server->fd, 0);
+    if (view == MAP_FAILED)
+        return NULL;
+    chip8_t *clone = (chip8_t *)view;
+#endif
+    return clone;
+}
+
+void unmapClone(fork_server_t *server, chip8_t *clone)
+{
+#if defined(_WIN32)
+    (void)server;
+    UnmapViewOfFile(clone);
+#else
+    munmap(clone, server->size);
+#endif
+}
+
+// Take a clone, pristine spares first
+chip8_t *forkClone(fork_server_t *server)
+{
+    if (server->spare_count)
+        return server->spares[--server->spare_count];
+    return mapClone(server);
+}
+
+// Drop clones' private pages so they read the snapshot again, then make them spares
+void recycleClones(fork_server_t *server)
+{
+    for (uint32_t i = 0; i < server->dirty_count; i++)
+    {
+        chip8_t *clone = server->dirty[i];
+#if defined(__linux__)
+        // Linux drops the private pages, the mapping reads the snapshot again
+        madvise(clone, server->size, MADV_DONTNEED);
+#else
+        // Windows views can't drop private pages and MADV_DONTNEED is only advisory elsewhere, replace the view
+        unmapClone(server, clone);
+        clone = mapClone(server);
+        if (!clone)
+            continue;
+#endif
+        server->spares[server->spare_count++] = clone;
+    }
+    server->dirty_count = 0;
+}
+
+// Reset "*clone" to the snapshot by swapping in a pristine clone
+bool forkReset(fork_server_t *server, chip8_t **clone)
+{
+    if (server->spare_count + server->dirty_count == server->capacity)
+    {
+        // grow both arrays before committing to the new capacity, either may already have moved
+        const uint32_t capacity = server->capacity ? server->capacity * 2 : 64;
+        chip8_t **spares = (chip8_t **)realloc(server->spares, capacity * sizeof *spares);
+        if (spares)
+            server->spares = spares;
+        chip8_t **dirty = (chip8_t **)realloc(server->dirty, capacity * sizeof *dirty);
+        if (dirty)
+            server->dirty = dirty;
+        if (!spares || !dirty)
+            return false;
+        server->capacity = capacity;
+    }
+    if (!server->spare_count)
+        recycleClones(server);
+
+    chip8_t *fresh = forkClone(server);
+    if (!fresh)
+        return false;
+    if (*clone)
+        server->dirty[server->dirty_count++] = *clone;
+    *clone = fresh;
+    return true;
+}
+
+// Give a clone back for good
+void forkRelease(fork_server_t *server, chip8_t *clone)
+{
+    if (clone)
+        unmapClone(server, clone);
+}
+
+void freeForkServer(fork_server_t *server)
+{
+    for (uint32_t i = 0; i < server->spare_count; i++)
+        unmapClone(server, server->spares[i]);
+    for (uint32_t i = 0; i < server->dirty_count; i++)
+        unmapClone(server, server->dirty[i]);
+    free(server->spares);
+    free(server->dirty);
+#if defined(_WIN32)
+    CloseHandle(server->mapping);
+#else
+    close(server->fd);
+#endif
+    memset(server, 0, sizeof *server);
+}
@@ -0,0 +1,309 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+// Raw deflate (RFC 1951) decoder for archive members, whose uncompressed size is known up front, and the
+// CRC-32 that zip uses to check them. Huffman codes up to INFLATE_FAST_BITS long (nearly all of them) are
+// decoded with one table lookup, longer ones bit by bit.
+#define INFLATE_FAST_BITS 9
+
+typedef struct
+{
+    uint16_t count[16];                    // number of codes of each length
+    uint16_t symbol[288];                  // symbols in canonical code order
+    uint16_t fast[1 << INFLATE_FAST_BITS]; // symbol << 4 | length for codes up to INFLATE_FAST_BITS, 0 otherwise
+} huffman_t;
+
+typedef struct
+{
+    const uint8_t *in;
+    size_t in_size;
+    size_t in_pos;
+    uint64_t bits;      // bit buffer, next bit lowest
+    uint32_t bit_count; // bits in the buffer
+    uint32_t pad;       // zero bits past the end of the input at the top of the buffer
+    bool overrun;       // a zero bit past the end was consumed
+    uint8_t *out;
+    size_t out_size;
+    size_t out_pos;
+} inflate_t;
+
+void refillBits(inflate_t *s)
+{
+    while (s->bit_count <= 56)
+    {
+        if (s->in_pos < s->in_size)
+            s->bits |= (uint64_t)s->in[s->in_pos++] << s->bit_count;
+        else
+            s->pad += 8; // only an error once consumed, the last code may end before the buffer does
+        s->bit_count += 8;
+    }
+}
+
+void dropBits(inflate_t *s, uint32_t n)
+{
+    s->bits >>= n;
+    s->bit_count -= n;
+    if (s->bit_count < s->pad)
+        s->overrun = true;
+}
+
+uint32_t getBits(inflate_t *s, uint32_t n)
+{
+    if (s->bit_count < n)
+        refillBits(s);
+    const uint32_t value = (uint32_t)(s->bits & ((1ull << n) - 1));
+    dropBits(s, n);
+    return value;
+}
+
+// Canonical Huffman code from code lengths; false if the lengths are over-subscribed
+bool buildHuffman(huffman_t *h, const uint8_t *lengths, uint32_t n)
+{
+    memset(h->count, 0, sizeof h->count);
+    memset(h->fast, 0, sizeof h->fast);
+    for (uint32_t i = 0; i < n; i++)
+        h->count[lengths[i]]++;
+    h->count[0] = 0;
+
+    int32_t left = 1;
+    for (uint32_t len = 1; len < 16; len++)
+    {
+        left = (left << 1) - h->count[len];
+        if (left < 0)
+            return false;
+    }
+
+    uint16_t offset[16] = {0};
+    for (uint32_t len = 1; len < 15; len++)
+        offset[len + 1] = offset[len] + h->count[len];
+    for (uint32_t i = 0; i < n; i++)
+        if (lengths[i])
+            h->symbol[offset[lengths[i]]++] = i;
+
+    // Deflate sends codes most significant bit first, so short codes are looked up bit reversed
+    uint32_t code = 0, index = 0;
+    for (uint32_t len = 1; len <= INFLATE_FAST_BITS; len++, code <<= 1)
+        for (uint32_t k = 0; k < h->count[len]; k++, code++)
+        {
+            uint32_t reversed = 0;
+            for (uint32_t b = 0; b < len; b++)
+                reversed |= ((code >> b) & 1) << (len - 1 - b);
+            const uint16_t entry = (uint16_t)(h->symbol[index++] << 4 | len);
+            for (uint32_t j = reversed; j < (1u << INFLATE_FAST_BITS); j += 1u << len)
+                h->fast[j] = entry;
+        }
+    return true;
+}
+
+// Next symbol, -1 for a code that isn't in the table
+int32_t decodeSymbol(inflate_t *s, const huffman_t *h)
+{
+    if (s->bit_count < 15)
+        refillBits(s);
+    const uint16_t fast = h->fast[s->bits & ((1u << INFLATE_FAST_BITS) - 1)];
+    if (fast)
+    {
+        dropBits(s, fast & 0xF);
+        return fast >> 4;
+    }
+    int32_t code = 0, first = 0, index = 0;
+    for (uint32_t len = 1; len < 16; len++)
+    {
+        code |= getBits(s, 1);
+        const int32_t count = h->count[len];
+        if (code - first < count)
+            return h->symbol[index + code - first];
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+// Literal/length and distance symbols of one block until its end of block code
+bool inflateCodes(inflate_t *s, const huffman_t *lengths, const huffman_t *distances)
+{
+    static const uint16_t length_base[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                             35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const uint8_t length_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    static const uint16_t distance_base[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+                                               1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+    static const uint8_t distance_extra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+    for (;;)
+    {
+        int32_t symbol = decodeSymbol(s, lengths);
+        if (symbol < 0 || s->overrun)
+            return false;
+        if (symbol < 256)
+        {
+            if (s->out_pos == s->out_size)
+                return false;
+            s->out[s->out_pos++] = (uint8_t)symbol;
+            continue;
+        }
+        if (symbol == 256)
+            return true;
+
+        symbol -= 257;
+        if (symbol >= 29)
+            return false;
+        const size_t length = length_base[symbol] + getBits(s, length_extra[symbol]);
+        symbol = decodeSymbol(s, distances);
+        if (symbol < 0 || symbol >= 30)
+            return false;
+        const size_t distance = distance_base[symbol] + getBits(s, distance_extra[symbol]);
+        if (s->overrun || distance > s->out_pos || length > s->out_size - s->out_pos)
+            return false;
+        // byte by byte, the copy may overlap its own output
+        const uint8_t *from = s->out + s->out_pos - distance;
+        uint8_t *to = s->out + s->out_pos;
+        for (size_t i = 0; i < length; i++)
+            to[i] = from[i];
+        s->out_pos += length;
+    }
+}
+
+bool inflateStored(inflate_t *s)
+{
+    dropBits(s, s->bit_count & 7);
+    const uint32_t length = getBits(s, 16);
+    if (getBits(s, 16) != (~length & 0xFFFF) || s->overrun || length > s->out_size - s->out_pos)
+        return false;
+    uint32_t left = length;
+    for (; left && s->bit_count >= 8; left--)
+        s->out[s->out_pos++] = (uint8_t)getBits(s, 8);
+    if (s->overrun || left > s->in_size - s->in_pos)
+        return false;
+    memcpy(s->out + s->out_pos, s->in + s->in_pos, left);
+    s->in_pos += left;
+    s->out_pos += left;
+    return true;
+}
+
+bool inflateFixed(inflate_t *s)
+{
+    static huffman_t lengths, distances;
+    static bool built = false;
+    if (!built)
+    {
+        uint8_t code_lengths[288 + 30];
+        memset(code_lengths, 8, 144);
+        memset(code_lengths + 144, 9, 112);
+        memset(code_lengths + 256, 7, 24);
+        memset(code_lengths + 280, 8, 8);
+        memset(code_lengths + 288, 5, 30);
+        buildHuffman(&lengths, code_lengths, 288);
+        buildHuffman(&distances, code_lengths + 288, 30);
+        built = true;
+    }
+    return inflateCodes(s, &lengths, &distances);
+}
+
+bool inflateDynamic(inflate_t *s)
+{
+    static const uint8_t order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+    const uint32_t nlen = getBits(s, 5) + 257;
+    const uint32_t ndist = getBits(s, 5) + 1;
+    const uint32_t ncode = getBits(s, 4) + 4;
+    if (nlen > 286 || ndist > 30)
+        return false;
+
+    uint8_t code_lengths[288 + 30] = {0};
+    for (uint32_t i = 0; i < ncode; i++)
+        code_lengths[order[i]] = (uint8_t)getBits(s, 3);
+    huffman_t lengths, distances;
+    if (s->overrun || !buildHuffman(&lengths, code_lengths, 19))
+        return false;
+
+    // Literal/length and distance code lengths, run length coded with the code length code
+    memset(code_lengths, 0, sizeof code_lengths);
+    for (uint32_t i = 0; i < nlen + ndist;)
+    {
+        const int32_t symbol = decodeSymbol(s, &lengths);
+        if (symbol < 0 || s->overrun)
+            return false;
+        if (symbol < 16)
+        {
+            code_lengths[i++] = (uint8_t)symbol;
+            continue;
+        }
+        uint8_t length = 0;
+        uint32_t repeat;
+        if (symbol == 16)
+        {
+            if (i == 0)
+                return false;
+            length = code_lengths[i - 1];
+            repeat = 3 + getBits(s, 2);
+        }
+        else if (symbol == 17)
+            repeat = 3 + getBits(s, 3);
+        else
+            repeat = 11 + getBits(s, 7);
+        if (i + repeat > nlen + ndist)
+            return false;
+        while (repeat--)
+            code_lengths[i++] = length;
+    }
+    if (code_lengths[256] == 0 || !buildHuffman(&lengths, code_lengths, nlen) ||
+        !buildHuffman(&distances, code_lengths + nlen, ndist))
+        return false;
+    return inflateCodes(s, &lengths, &distances);
+}
+
+// Decode raw deflate data "in" into exactly "out_size" bytes at "out"
+bool inflateRaw(const uint8_t *in, size_t in_size, uint8_t *out, size_t out_size)
+{
+    inflate_t s = {};
+    s.in = in;
+    s.in_size = in_size;
+    s.out = out;
+    s.out_size = out_size;
+    bool last;
+    do
+    {
+        last = getBits(&s, 1);
+        bool ok;
+        switch (getBits(&s, 2))
+        {
+        case 0:
+            ok = inflateStored(&s);
+            break;
+        case 1:
+            ok = inflateFixed(&s);
+            break;
+        case 2:
+            ok = inflateDynamic(&s);
+            break;
+        default:
+            ok = false;
+        }
+        if (!ok || s.overrun)
+            return false;
+    } while (!last);
+    return s.out_pos == out_size;
+}
+
+// CRC-32 (IEEE, reflected) as stored in zip and gzip headers
+uint32_t computeCrc32(const uint8_t *data, size_t size)
+{
+    static const struct crc_table_t
+    {
+        uint32_t entries[256];
+        crc_table_t()
+        {
+            for (uint32_t i = 0; i < 256; i++)
+            {
+                uint32_t crc = i;
+                for (int b = 0; b < 8; b++)
+                    crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+                entries[i] = crc;
+            }
+        }
+    } table;
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; i++)
+        crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
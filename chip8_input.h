@@ -0,0 +1,94 @@
+#pragma once
+#include <stdio.h>
+#include <cstdlib>
+#include <iostream>
+
+#include "chip8.h"
+
+// Keypad state change at the start of a 60Hz frame
+typedef struct
+{
+    uint32_t frame;
+    uint16_t keys; // bit N set = key N held down
+} input_event_t;
+
+// Scripted keypad input, one "<frame> <key mask hex>" per line, '#' starts a comment
+typedef struct
+{
+    input_event_t *events; // sorted by frame
+    uint32_t count;
+    uint32_t next; // next event to apply
+} input_script_t;
+
+void freeInputScript(input_script_t *script)
+{
+    free(script->events);
+    script->events = NULL;
+    script->count = 0;
+}
+
+bool loadInputScript(input_script_t *script, const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        std::cout << "Input script " << path << " invalid or does not exist!\n";
+        return false;
+    }
+
+    uint32_t capacity = 0;
+    char line[256];
+    script->events = NULL;
+    script->count = 0;
+    script->next = 0;
+    while (fgets(line, sizeof line, file))
+    {
+        uint32_t frame, keys;
+        if (line[0] == '#' || sscanf(line, "%u %x", &frame, &keys) != 2)
+            continue;
+        if (script->count && frame < script->events[script->count - 1].frame)
+        {
+            std::cout << "Input script " << path << " frames out of order at frame " << frame << "\n";
+            continue;
+        }
+        if (script->count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 64;
+            input_event_t *events = (input_event_t *)realloc(script->events, capacity * sizeof *events);
+            if (!events)
+            {
+                std::cout << "Input script " << path << " invalid or does not exist!\n";
+                fclose(file);
+                freeInputScript(script);
+                return false;
+            }
+            script->events = events;
+        }
+        script->events[script->count++] = (input_event_t){.frame = frame, .keys = (uint16_t)keys};
+    }
+    fclose(file);
+    return true;
+}
+
+// Set keypad from a key bit mask
+void setKeypad(chip8_t *chip8, uint16_t keys)
+{
+    for (uint8_t i = 0; i < sizeof chip8->keypad; i++)
+        chip8->keypad[i] = (keys >> i) & 1;
+}
+
+// Key bit mask of the keypad
+uint16_t getKeypad(const chip8_t *chip8)
+{
+    uint16_t keys = 0;
+    for (uint8_t i = 0; i < sizeof chip8->keypad; i++)
+        keys |= chip8->keypad[i] << i;
+    return keys;
+}
+
+// Apply all scripted keypad changes due at the start of "frame"
+void applyInputScript(input_script_t *script, chip8_t *chip8, uint32_t frame)
+{
+    while (script->next < script->count && script->events[script->next].frame <= frame)
+        setKeypad(chip8, script->events[script->next++].keys);
+}
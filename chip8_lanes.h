@@ -0,0 +1,455 @@
+#pragma once
+#include <stdio.h>
+#include <cstring>
+
+#include "chip8_core.h"
+
+// Machines per lockstep group: 8, 16 or 32
+#ifndef CHIP8_LANES
+#define CHIP8_LANES 16
+#endif
+
+// One register of every lane in a single vector, compiled to SSE/AVX2/AVX-512 depending on -m flags
+typedef uint8_t lane_u8 __attribute__((vector_size(CHIP8_LANES)));
+typedef int8_t lane_s8 __attribute__((vector_size(CHIP8_LANES)));
+typedef uint16_t lane_u16 __attribute__((vector_size(CHIP8_LANES * 2)));
+typedef int16_t lane_s16 __attribute__((vector_size(CHIP8_LANES * 2)));
+typedef uint32_t lane_mask_t; // bit N = lane N
+
+// Structure of arrays CHIP8 machines, registers are lane-major so V[x] is one vector across all lanes
+typedef struct
+{
+    lane_u8 V[16];         // v registers
+    lane_u16 I;            // index register
+    lane_u16 PC;           // program counter
+    lane_u8 delay_timer;
+    lane_u8 sound_timer;
+    lane_u8 sp;            // stack depth
+    lane_u16 stack[16];    // 16 level stack, 12-bit return addresses
+    lane_mask_t running;   // lanes still emulating
+    lane_mask_t draw;      // lanes that changed their display
+    uint8_t await_key[CHIP8_LANES]; // FX0A key pressed and awaiting release, 0xFF if none yet
+    uint32_t rng[CHIP8_LANES];      // CXNN xorshift32 state
+    uint8_t pattern[CHIP8_LANES][16];
+    uint8_t pitch[CHIP8_LANES];
+    bool keypad[CHIP8_LANES][16];
+    uint8_t ram[CHIP8_LANES][4096];
+    bool display[CHIP8_LANES][64 * 32];
+} chip8_lanes_t;
+
+// Expand lane bit mask to a 0xFF/0x00 byte per lane
+lane_u8 laneMask8(lane_mask_t mask)
+{
+    lane_u8 m;
+    for (int l = 0; l < CHIP8_LANES; l++)
+        m[l] = -(uint8_t)((mask >> l) & 1);
+    return m;
+}
+
+// Widen 0xFF/0x00 byte lanes to 0xFFFF/0x0000 for the 16-bit registers
+lane_u16 widenMask(lane_u8 m)
+{
+    return (lane_u16)__builtin_convertvector((lane_s8)m, lane_s16);
+}
+
+// Load one lane from a scalar machine
+void setLane(chip8_lanes_t *lanes, uint8_t lane, const chip8_t *chip8)
+{
+    for (uint8_t x = 0; x < 16; x++)
+        lanes->V[x][lane] = chip8->V[x];
+    lanes->I[lane] = chip8->I;
+    lanes->PC[lane] = chip8->PC;
+    lanes->delay_timer[lane] = chip8->delay_timer;
+    lanes->sound_timer[lane] = chip8->sound_timer;
+    lanes->sp[lane] = chip8->sp;
+    for (uint8_t i = 0; i < 16; i++)
+        lanes->stack[i][lane] = chip8->stack[i];
+    lanes->running = (lanes->running & ~(1u << lane)) | ((lane_mask_t)(chip8->state == RUNNING) << lane);
+    lanes->draw = (lanes->draw & ~(1u << lane)) | ((lane_mask_t)chip8->draw << lane);
+    lanes->await_key[lane] = chip8->await_key;
+    lanes->rng[lane] = chip8->rng;
+    memcpy(lanes->pattern[lane], chip8->pattern, sizeof chip8->pattern);
+    lanes->pitch[lane] = chip8->pitch;
+    memcpy(lanes->keypad[lane], chip8->keypad, sizeof chip8->keypad);
+    memcpy(lanes->ram[lane], chip8->ram, sizeof chip8->ram);
+    memcpy(lanes->display[lane], chip8->display, sizeof chip8->display);
+}
+
+// Store one lane to a scalar machine, e.g. for comparing against emulateInstruction
+void getLane(const chip8_lanes_t *lanes, uint8_t lane, chip8_t *chip8)
+{
+    for (uint8_t x = 0; x < 16; x++)
+        chip8->V[x] = lanes->V[x][lane];
+    chip8->I = lanes->I[lane];
+    chip8->PC = lanes->PC[lane];
+    chip8->delay_timer = lanes->delay_timer[lane];
+    chip8->sound_timer = lanes->sound_timer[lane];
+    for (uint8_t i = 0; i < 16; i++)
+        chip8->stack[i] = lanes->stack[i][lane];
+    chip8->sp = lanes->sp[lane];
+    chip8->state = (lanes->running >> lane) & 1 ? RUNNING : QUIT;
+    chip8->draw = (lanes->draw >> lane) & 1;
+    chip8->await_key = lanes->await_key[lane];
+    chip8->rng = lanes->rng[lane];
+    memcpy(chip8->pattern, lanes->pattern[lane], sizeof chip8->pattern);
+    chip8->pitch = lanes->pitch[lane];
+    memcpy(chip8->keypad, lanes->keypad[lane], sizeof chip8->keypad);
+    memcpy(chip8->ram, lanes->ram[lane], sizeof chip8->ram);
+    memcpy(chip8->display, lanes->display[lane], sizeof chip8->display);
+}
+
+// Boot every lane from the same machine
+void initLanes(chip8_lanes_t *lanes, const chip8_t *chip8)
+{
+    memset(lanes, 0, sizeof *lanes);
+    for (uint8_t l = 0; l < CHIP8_LANES; l++)
+        setLane(lanes, l, chip8);
+}
+
+// Execute "opcode" for every lane in "mask". Register ops run as one vector op across the lanes,
+// memory/display/keypad ops fall back to a per lane loop.
+void executeLanes(chip8_lanes_t *lanes, uint16_t opcode, lane_mask_t mask, const config_t config)
+{
+    const uint16_t NNN = opcode & 0x0FFF;
+    const uint8_t NN = opcode & 0x0FF;
+    const uint8_t N = opcode & 0x0F;
+    const uint8_t X = (opcode >> 8) & 0x0F;
+    const uint8_t Y = (opcode >> 4) & 0x0F;
+
+    const lane_u8 m = laneMask8(mask);
+    const lane_u16 m16 = widenMask(m);
+    lane_u8 *VX = &lanes->V[X];
+    const lane_u8 VY = lanes->V[Y];
+    lane_u8 *VF = &lanes->V[0xF];
+    lane_u8 carry;
+
+// per lane fallback, "l" is the lane index
+#define FOR_EACH_LANE for (lane_mask_t bits = mask, l; bits && (l = __builtin_ctz(bits), true); bits &= bits - 1)
+
+    // pre-increment Program counter
+    lanes->PC += m16 & 2;
+
+    switch ((opcode >> 12) & 0x0F)
+    {
+    case 0x00:
+        if (NN == 0xE0)
+        {
+            // 0x00E0: Clears the screen.
+            FOR_EACH_LANE memset(lanes->display[l], false, sizeof lanes->display[l]);
+            lanes->draw |= mask;
+        }
+        else if (NN == 0xEE)
+        {
+            // 0x00EE: Returns from a subroutine.
+            lanes->sp -= m & 1;
+            FOR_EACH_LANE lanes->PC[l] = lanes->stack[lanes->sp[l] & 0xF][l];
+        }
+        break;
+
+    case 0x01:
+        // 0x1NNN: Jumps to address NNN.
+        lanes->PC = (lanes->PC & ~m16) | (m16 & NNN);
+        break;
+
+    case 0x02:
+        // 0x2NNN: Calls subroutine at NNN.
+        FOR_EACH_LANE lanes->stack[lanes->sp[l] & 0xF][l] = lanes->PC[l];
+        lanes->sp += m & 1;
+        lanes->PC = (lanes->PC & ~m16) | (m16 & NNN);
+        break;
+
+    case 0x03:
+        // 0x3XNN: Skips the next instruction if VX equals NN.
+        lanes->PC += widenMask((lane_u8)(*VX == NN) & m) & 2;
+        break;
+
+    case 0x04:
+        // 0x4XNN: Skips the next instruction if VX does not equal NN.
+        lanes->PC += widenMask((lane_u8)(*VX != NN) & m) & 2;
+        break;
+
+    case 0x05:
+        // 0x5XY0: Skips the next instruction if VX equals VY.
+        if (N == 0)
+            lanes->PC += widenMask((lane_u8)(*VX == VY) & m) & 2;
+        break;
+
+    case 0x06:
+        // 0x6XNN: Sets VX to NN.
+        *VX = (*VX & ~m) | (m & NN);
+        break;
+
+    case 0x07:
+        // 0x7XNN: Adds NN to VX (carry flag is not changed).
+        *VX += m & NN;
+        break;
+
+    case 0x08:
+        switch (N)
+        {
+        case 0:
+            // 0x8XY0: Sets VX to the value of VY.
+            *VX = (*VX & ~m) | (VY & m);
+            break;
+
+        case 1:
+            // 0x8XY1: Sets VX to VX or VY.
+            *VX |= VY & m;
+            break;
+
+        case 2:
+            // 0x8XY2: Sets VX to VX and VY.
+            *VX &= VY | ~m;
+            break;
+
+        case 3:
+            // 0x8XY3: Sets VX to VX xor VY.
+            *VX ^= VY & m;
+            break;
+
+        case 4:
+        {
+            // 0x8XY4: Adds VY to VX. VF is set to 1 when there's a carry, and to 0 when there is not.
+            const lane_u8 sum = *VX + VY;
+            carry = (lane_u8)(sum < *VX) & 1;
+            *VX = (*VX & ~m) | (sum & m);
+            *VF = (*VF & ~m) | (carry & m);
+            break;
+        }
+
+        case 5:
+            // 0x8XY5: VY is subtracted from VX. VF is set to 0 when there's a borrow, and 1 when there is not.
+            carry = (lane_u8)(VY <= *VX) & 1;
+            *VX -= VY & m;
+            *VF = (*VF & ~m) | (carry & m);
+            break;
+
+        case 6:
+            // 0x8XY6: Stores the least significant bit of VX in VF and then shifts VX to the right by 1.
+            carry = *VX & 1;
+            *VX = (*VX & ~m) | ((*VX >> 1) & m);
+            *VF = (*VF & ~m) | (carry & m);
+            break;
+
+        case 7:
+            // 0x8XY7: Sets VX to VY minus VX. VF is set to 0 when there's a borrow, and 1 when there is not.
+            carry = (lane_u8)(*VX <= VY) & 1;
+            *VX = (*VX & ~m) | ((VY - *VX) & m);
+            *VF = (*VF & ~m) | (carry & m);
+            break;
+
+        case 0xE:
+            // 0x8XYE: Stores the most significant bit of VX in VF and then shifts VX to the left by 1.
+            carry = *VX >> 7;
+            *VX = (*VX & ~m) | ((*VX << 1) & m);
+            *VF = (*VF & ~m) | (carry & m);
+            break;
+
+        default:
+            break;
+        }
+        break;
+
+    case 0x09:
+        // 0x9XY0: Skips the next instruction if VX does not equal VY.
+        lanes->PC += widenMask((lane_u8)(*VX != VY) & m) & 2;
+        break;
+
+    case 0x0A:
+        // 0xANNN: Sets I to the address NNN.
+        lanes->I = (lanes->I & ~m16) | (m16 & NNN);
+        break;
+
+    case 0x0B:
+        // 0xBNNN: Jump to V0 + NNN
+        lanes->PC = (lanes->PC & ~m16) | ((__builtin_convertvector(lanes->V[0], lane_u16) + NNN) & m16);
+        break;
+
+    case 0x0C:
+        // 0xCXNN: Sets register VX = rand() % 256 & NN (bitwise AND)
+        FOR_EACH_LANE
+        {
+            uint32_t x = lanes->rng[l];
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            lanes->rng[l] = x;
+            (*VX)[l] = (x >> 24) & NN;
+        }
+        break;
+
+    case 0x0D:
+        // 0xDXYN: Draw N-height sprite at coords X,Y; Read from memory location I;
+        //   Screen pixels are XOR'd with sprite bits, VF is set if any screen pixels are set off
+        FOR_EACH_LANE
+        {
+            uint8_t X_coord = (*VX)[l] % config.window_width;
+            uint8_t Y_coord = VY[l] % config.window_height;
+            const uint8_t orig_X = X_coord;
+            uint8_t collision = 0;
+
+            for (uint8_t i = 0; i < N; i++)
+            {
+                const uint8_t sprite_data = lanes->ram[l][(lanes->I[l] + i) & 0xFFF];
+                X_coord = orig_X;
+
+                for (int8_t j = 7; j >= 0; j--)
+                {
+                    bool *pixel = &lanes->display[l][Y_coord * config.window_width + X_coord];
+                    const bool sprite_bit = (sprite_data & (1 << j));
+
+                    collision |= sprite_bit && *pixel;
+                    *pixel ^= sprite_bit;
+
+                    if (++X_coord >= config.window_width)
+                        break;
+                }
+
+                if (++Y_coord >= config.window_height)
+                    break;
+            }
+            (*VF)[l] = collision;
+        }
+        lanes->draw |= mask;
+        break;
+
+    case 0x0E:
+        if (NN == 0x9E)
+        {
+            // 0xEX9E: Skips the next instruction if the key stored in VX is pressed.
+            FOR_EACH_LANE if (lanes->keypad[l][(*VX)[l] & 0xF]) lanes->PC[l] += 2;
+        }
+        else if (NN == 0xA1)
+        {
+            // 0xEXA1: Skips the next instruction if the key stored in VX is not pressed.
+            FOR_EACH_LANE if (!lanes->keypad[l][(*VX)[l] & 0xF]) lanes->PC[l] += 2;
+        }
+        break;
+
+    case 0x0F:
+        switch (NN)
+        {
+        case 0x02:
+            // 0xF002: XO-CHIP, loads the 16 byte audio pattern buffer from memory starting at I.
+            if (X == 0)
+                FOR_EACH_LANE for (uint8_t i = 0; i < 16; i++) lanes->pattern[l][i] = lanes->ram[l][(lanes->I[l] + i) & 0xFFF];
+            break;
+
+        case 0x3A:
+            // 0xFX3A: XO-CHIP, sets the audio pattern playback pitch to VX.
+            FOR_EACH_LANE lanes->pitch[l] = (*VX)[l];
+            break;
+
+        case 0x0A:
+            // 0xFX0A: A key press is awaited, and then stored in VX (blocking operation).
+            FOR_EACH_LANE
+            {
+                for (uint8_t i = 0; lanes->await_key[l] == 0xFF && i < 16; i++)
+                    if (lanes->keypad[l][i])
+                        lanes->await_key[l] = i;
+
+                if (lanes->await_key[l] == 0xFF || lanes->keypad[l][lanes->await_key[l]])
+                    lanes->PC[l] -= 2; // Keep waiting for a key press, then for its release
+                else
+                {
+                    (*VX)[l] = lanes->await_key[l];
+                    lanes->await_key[l] = 0xFF;
+                }
+            }
+            break;
+
+        case 0x1E:
+            // 0xFX1E: Adds VX to I. VF is not affected.
+            lanes->I += __builtin_convertvector(*VX, lane_u16) & m16;
+            break;
+
+        case 0x07:
+            // 0xFX07: Sets VX to the value of the delay timer.
+            *VX = (*VX & ~m) | (lanes->delay_timer & m);
+            break;
+
+        case 0x15:
+            // 0xFX15: Sets the delay timer to VX.
+            lanes->delay_timer = (lanes->delay_timer & ~m) | (*VX & m);
+            break;
+
+        case 0x18:
+            // 0xFX18: Sets the sound timer to VX.
+            lanes->sound_timer = (lanes->sound_timer & ~m) | (*VX & m);
+            break;
+
+        case 0x29:
+            // 0xFX29: Sets I to the location of the sprite for the character in VX.
+            lanes->I = (lanes->I & ~m16) | ((__builtin_convertvector(*VX, lane_u16) * 5) & m16);
+            break;
+
+        case 0x33:
+            // 0xFX33: Stores the binary-coded decimal representation of VX at I, I+1 and I+2.
+            FOR_EACH_LANE
+            {
+                const uint8_t bcd = (*VX)[l];
+                lanes->ram[l][lanes->I[l] & 0xFFF] = bcd / 100;
+                lanes->ram[l][(lanes->I[l] + 1) & 0xFFF] = bcd / 10 % 10;
+                lanes->ram[l][(lanes->I[l] + 2) & 0xFFF] = bcd % 10;
+            }
+            break;
+
+        case 0x55:
+            // 0xFX55: Stores from V0 to VX (including VX) in memory, starting at address I. I is left unmodified.
+            FOR_EACH_LANE for (uint8_t i = 0; i <= X; i++) lanes->ram[l][(lanes->I[l] + i) & 0xFFF] = lanes->V[i][l];
+            break;
+
+        case 0x65:
+            // 0xFX65: Fills from V0 to VX (including VX) with values from memory, starting at address I.
+            FOR_EACH_LANE for (uint8_t i = 0; i <= X; i++) lanes->V[i][l] = lanes->ram[l][(lanes->I[l] + i) & 0xFFF];
+            break;
+
+        default:
+            break;
+        }
+        break;
+
+    default:
+        break;
+    }
+#undef FOR_EACH_LANE
+}
+
+// Emulate one instruction on every running lane. Lanes are grouped by opcode, each group executes
+// together under its lane mask; lanes that diverged are regrouped on the next pass.
+void stepLanes(chip8_lanes_t *lanes, const config_t config)
+{
+    uint16_t opcode[CHIP8_LANES];
+    for (uint8_t l = 0; l < CHIP8_LANES; l++)
+        opcode[l] = (lanes->ram[l][lanes->PC[l] & 0xFFF] << 8) | lanes->ram[l][(lanes->PC[l] + 1) & 0xFFF];
+
+    lane_mask_t pending = lanes->running;
+    while (pending)
+    {
+        const uint16_t op = opcode[__builtin_ctz(pending)];
+        lane_mask_t group = 0;
+        for (uint8_t l = 0; l < CHIP8_LANES; l++)
+            group |= (lane_mask_t)(opcode[l] == op) << l;
+        group &= pending;
+
+        executeLanes(lanes, op, group, config);
+        pending &= ~group;
+    }
+}
+
+// 60Hz timer tick of every running lane, like updateTimers
+void updateLanesTimers(chip8_lanes_t *lanes)
+{
+    const lane_u8 m = laneMask8(lanes->running);
+    lanes->delay_timer -= (lane_u8)(lanes->delay_timer != 0) & m & 1;
+    lanes->sound_timer -= (lane_u8)(lanes->sound_timer != 0) & m & 1;
+}
+
+// Emulate one 60Hz frame on every running lane, then tick the timers
+void emulateLanesFrame(chip8_lanes_t *lanes, const config_t config)
+{
+    const uint32_t insts = config.insts_per_second / 60 ? config.insts_per_second / 60 : 1;
+    for (uint32_t i = 0; i < insts; i++)
+        stepLanes(lanes, config);
+    updateLanesTimers(lanes);
+}
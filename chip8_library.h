@@ -0,0 +1,411 @@
+#pragma once
+#include <stdio.h>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <unordered_map>
+#include <filesystem>
+
+#include "chip8.h"
+#include "chip8_map.h"
+#include "chip8_archive.h"
+#include "chip8_disasm.h"
+
+// ROM library index: one fixed size record per ROM file (content hash, size, platform, quirks, recommended
+// instructions per second), sorted by hash, followed by a table of the files' absolute paths. The file is
+// used in place through a read-only mapping, so looking up a ROM costs a binary search and no I/O beyond
+// the pages touched. Records are host byte order (checked through the header on open).
+//   header: "C8LB", u16 version, u16 record size, u32 record count, u32 path table offset, u32 path table size, u32 0
+//   records, path table (NUL terminated paths)
+#define LIBRARY_VERSION 1
+
+typedef enum
+{
+    PLATFORM_CHIP8,
+    PLATFORM_SCHIP,  // SUPER-CHIP 1.1
+    PLATFORM_XOCHIP,
+} platform_t;
+
+const char *platform_names[] = {"chip-8", "schip", "xo-chip"};
+
+// Behaviours that differ between interpreters, named as in the common quirk test ROMs
+typedef enum
+{
+    QUIRK_VF_RESET = 1 << 0,     // 8XY1/8XY2/8XY3 clear VF
+    QUIRK_MEMORY = 1 << 1,       // FX55/FX65 leave I incremented past the last register
+    QUIRK_SHIFT = 1 << 2,        // 8XY6/8XYE shift VX in place instead of VY into VX
+    QUIRK_JUMP = 1 << 3,         // BNNN jumps to VX + NN (BXNN) instead of V0 + NNN
+    QUIRK_CLIP = 1 << 4,         // sprites are clipped at the screen edges instead of wrapping
+    QUIRK_DISPLAY_WAIT = 1 << 5, // DXYN waits for the next 60Hz frame
+} quirk_t;
+
+const char *quirk_names[] = {"vf_reset", "memory", "shift", "jump", "clip", "display_wait"};
+#define QUIRK_COUNT 6
+
+// What emulateInstruction does
+#define CORE_QUIRKS (QUIRK_SHIFT | QUIRK_CLIP)
+
+// Each platform's quirk profile and recommended instructions per second
+const struct
+{
+    uint8_t quirks;
+    uint16_t ips;
+} platform_profiles[] = {
+    {QUIRK_VF_RESET | QUIRK_MEMORY | QUIRK_CLIP | QUIRK_DISPLAY_WAIT, 700},
+    {QUIRK_SHIFT | QUIRK_JUMP | QUIRK_CLIP, 1800},
+    {QUIRK_MEMORY, 6000},
+};
+
+typedef struct
+{
+    uint64_t hash;     // hashRom of the image
+    int64_t mtime;     // file modification time (file clock ticks, seconds for archive members), rescans rehash only changed files
+    uint32_t size;     // bytes
+    uint32_t path;     // offset in the path table
+    uint16_t ips;      // recommended instructions per second
+    uint8_t platform;  // platform_t
+    uint8_t quirks;    // quirk_t bits of the platform's profile
+    uint8_t sensitive; // quirk_t bits the ROM's code can observe, i.e. the ones that matter for it
+    uint8_t padding[3];
+} library_entry_t;
+static_assert(sizeof(library_entry_t) == 32, "library index record layout");
+
+typedef struct
+{
+    char magic[4];
+    uint16_t version;
+    uint16_t entry_size;
+    uint32_t count;
+    uint32_t paths;      // path table offset
+    uint32_t paths_size;
+    uint32_t reserved;   // keeps the records 8 byte aligned
+} library_header_t;
+
+typedef struct
+{
+    mapped_file_t file;
+    const library_entry_t *entries; // sorted by hash
+    uint32_t count;
+    const char *paths;
+} library_t;
+
+// FNV-1a hash of a ROM image, same function as hashChip8
+uint64_t hashRom(const uint8_t *data, size_t size)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ data[i]) * 0x100000001B3ull;
+    return hash;
+}
+
+// Fill platform, quirks, sensitivity and IPS from the ROM's reachable code (see chip8_disasm.h). Extension
+// ".sc8"/".xo8" decides when the code doesn't; XO-CHIP ROMs are also the only ones too big for 4KB.
+void detectRom(library_entry_t *entry, const uint8_t *rom, size_t size, const char *path)
+{
+    static disasm_t disasm;
+    platform_t platform = PLATFORM_CHIP8;
+    uint8_t sensitive = 0;
+    if (!disassemble(&disasm, rom, size))
+        platform = PLATFORM_XOCHIP;
+    else
+    {
+        bool schip = false, xochip = false;
+        for (uint16_t addr = DISASM_ENTRY; addr < disasm.rom_end; addr++)
+        {
+            if (disasm.kind[addr] != BYTE_CODE)
+                continue;
+            const uint16_t opcode = disasmOpcode(&disasm, addr);
+            const uint8_t X = (opcode >> 8) & 0xF, Y = (opcode >> 4) & 0xF, N = opcode & 0xF, NN = opcode & 0xFF;
+            switch (opcode >> 12)
+            {
+            case 0x0:
+                schip |= (opcode & 0xFFF0) == 0x00C0 || (opcode >= 0x00FB && opcode <= 0x00FF);
+                xochip |= (opcode & 0xFFF0) == 0x00D0;
+                break;
+            case 0x5:
+                xochip |= N == 2 || N == 3;
+                break;
+            case 0x8:
+                if (N == 1 || N == 2 || N == 3)
+                    sensitive |= QUIRK_VF_RESET;
+                if ((N == 6 || N == 0xE) && X != Y)
+                    sensitive |= QUIRK_SHIFT;
+                break;
+            case 0xB:
+                if (X != 0) // BNNN and BXNN agree when X is 0
+                    sensitive |= QUIRK_JUMP;
+                break;
+            case 0xD:
+                sensitive |= QUIRK_CLIP | QUIRK_DISPLAY_WAIT;
+                schip |= N == 0;
+                break;
+            case 0xF:
+                if (NN == 0x55 || NN == 0x65)
+                    sensitive |= QUIRK_MEMORY;
+                schip |= NN == 0x30 || NN == 0x75 || NN == 0x85;
+                xochip |= opcode == 0xF000 || NN == 0x01 || opcode == 0xF002 || NN == 0x3A;
+                break;
+            }
+        }
+        const std::string extension = std::filesystem::path(path).extension().string();
+        if (xochip || extension == ".xo8")
+            platform = PLATFORM_XOCHIP;
+        else if (schip || extension == ".sc8")
+            platform = PLATFORM_SCHIP;
+    }
+
+    entry->platform = platform;
+    entry->quirks = platform_profiles[platform].quirks;
+    entry->ips = platform_profiles[platform].ips;
+    entry->sensitive = sensitive;
+}
+
+void closeLibrary(library_t *library)
+{
+    unmapFile(&library->file);
+    memset(library, 0, sizeof *library);
+}
+
+bool openLibrary(library_t *library, const char *path)
+{
+    memset(library, 0, sizeof *library);
+    if (!mapFile(&library->file, path))
+    {
+        std::cout << "ROM library " << path << " invalid or does not exist!\n";
+        return false;
+    }
+    library_header_t header;
+    const uint8_t *data = library->file.data;
+    const size_t size = library->file.size;
+    if (size >= sizeof header)
+        memcpy(&header, data, sizeof header);
+    if (size < sizeof header || memcmp(header.magic, "C8LB", 4) != 0 || header.version != LIBRARY_VERSION ||
+        header.entry_size != sizeof(library_entry_t) || sizeof header + (size_t)header.count * sizeof(library_entry_t) > size ||
+        (size_t)header.paths + header.paths_size > size || header.paths_size == 0 || data[header.paths + header.paths_size - 1] != '\0')
+    {
+        std::cout << "Unsupported ROM library " << path << ", rebuild it\n";
+        unmapFile(&library->file);
+        return false;
+    }
+    library->entries = (const library_entry_t *)(data + sizeof header);
+    library->count = header.count;
+    library->paths = (const char *)data + header.paths;
+    for (uint32_t i = 0; i < library->count; i++)
+        if (library->entries[i].path >= header.paths_size)
+        {
+            std::cout << "Corrupt ROM library " << path << ", rebuild it\n";
+            closeLibrary(library);
+            return false;
+        }
+    return true;
+}
+
+const char *libraryPath(const library_t *library, const library_entry_t *entry)
+{
+    return library->paths + entry->path;
+}
+
+// Entry for the ROM with content hash "hash", NULL if it isn't in the library
+const library_entry_t *libraryFind(const library_t *library, uint64_t hash)
+{
+    const library_entry_t *end = library->entries + library->count;
+    const library_entry_t *entry = std::lower_bound(library->entries, end, hash,
+                                                    [](const library_entry_t &e, uint64_t h)
+                                                    { return e.hash < h; });
+    return entry != end && entry->hash == hash ? entry : NULL;
+}
+
+// Entry for a ROM file: by path when the file is unchanged since it was indexed, otherwise by content
+// (renamed, moved or copied ROMs are still found). ROMs in archives are found by their "<archive>/<member>" path.
+const library_entry_t *libraryLookup(const library_t *library, const char *rom_path)
+{
+    std::error_code error;
+    const std::filesystem::path path = std::filesystem::absolute(rom_path, error);
+    const uint64_t size = std::filesystem::file_size(path, error);
+    if (error)
+    {
+        const std::string name = path.lexically_normal().string();
+        for (uint32_t i = 0; i < library->count; i++)
+            if (name == libraryPath(library, &library->entries[i]))
+                return &library->entries[i];
+        return NULL;
+    }
+    const int64_t mtime = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+    const std::string name = path.lexically_normal().string();
+    for (uint32_t i = 0; i < library->count; i++)
+        if (library->entries[i].size == size && library->entries[i].mtime == mtime && name == libraryPath(library, &library->entries[i]))
+            return &library->entries[i];
+
+    mapped_file_t rom;
+    if (!mapFile(&rom, rom_path))
+        return NULL;
+    const library_entry_t *entry = libraryFind(library, hashRom(rom.data, rom.size));
+    unmapFile(&rom);
+    return entry;
+}
+
+// Index every ROM (.ch8, .c8, .sc8, .xo8) under "dirs", or named there directly, into "index_path", including
+// the ROMs inside zip and tar archives. ROMs already in the old index with the same path, size and modification
+// time keep their record without being read (or, in an archive, decompressed).
+bool buildLibrary(const char *index_path, const std::vector<std::string> &dirs, uint32_t *scanned, uint32_t *hashed)
+{
+    library_t old = {};
+    std::error_code error;
+    if (std::filesystem::exists(index_path, error) && !openLibrary(&old, index_path))
+        std::cout << "Rebuilding ROM library from scratch\n";
+
+    std::unordered_map<std::string, const library_entry_t *> known;
+    for (uint32_t i = 0; i < old.count; i++)
+        known[libraryPath(&old, &old.entries[i])] = &old.entries[i];
+
+    // ROM files and archives: the ones named directly and everything with their extensions under the directories
+    std::vector<std::filesystem::path> files;
+    for (const std::string &dir : dirs)
+    {
+        if (std::filesystem::is_regular_file(dir, error))
+        {
+            files.push_back(dir);
+            continue;
+        }
+        auto it = std::filesystem::recursive_directory_iterator(dir, error);
+        if (error)
+            std::cout << "Could not scan ROM directory " << dir << ": " << error.message() << "\n";
+        for (; !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error))
+        {
+            const std::string name = it->path().filename().string();
+            if ((isRomName(name.c_str()) || isArchiveName(name.c_str())) && it->is_regular_file(error))
+                files.push_back(it->path());
+        }
+    }
+
+    std::vector<library_entry_t> entries;
+    std::string paths;
+    *scanned = *hashed = 0;
+    // Keep the old record of an unchanged ROM, otherwise hash and detect the contents "load" reads
+    const auto add = [&](const std::string &name, library_entry_t entry, const auto &load)
+    {
+        (*scanned)++;
+        const auto it = known.find(name);
+        if (it != known.end() && it->second->size == entry.size && it->second->mtime == entry.mtime)
+            entry = *it->second;
+        else
+        {
+            const uint8_t *rom;
+            if (!load(&rom))
+                return;
+            entry.hash = hashRom(rom, entry.size);
+            detectRom(&entry, rom, entry.size, name.c_str());
+            (*hashed)++;
+        }
+        entry.path = (uint32_t)paths.size();
+        paths.append(name).push_back('\0');
+        entries.push_back(entry);
+    };
+    for (const std::filesystem::path &file : files)
+    {
+        const std::string name = std::filesystem::absolute(file, error).lexically_normal().string();
+        library_entry_t entry = {};
+        entry.mtime = std::filesystem::last_write_time(file, error).time_since_epoch().count();
+        if (error)
+            continue;
+
+        // Archive members are indexed as "<archive path>/<member>", with the member's own size and time
+        if (isArchiveName(name.c_str()))
+        {
+            archive_t archive;
+            if (!openArchive(&archive, name.c_str()))
+                continue;
+            archive_entry_t member;
+            while (nextArchiveEntry(&archive, &member))
+                if (isRomName(member.name))
+                {
+                    entry.size = member.size;
+                    entry.mtime = member.mtime;
+                    add(name + "/" + member.name, entry, [&](const uint8_t **rom)
+                        { return (*rom = readArchiveEntry(&archive, &member)) != NULL; });
+                }
+            closeArchive(&archive);
+            continue;
+        }
+
+        mapped_file_t rom = {};
+        entry.size = (uint32_t)std::filesystem::file_size(file, error);
+        if (error)
+            continue;
+        add(name, entry, [&](const uint8_t **data)
+            {
+                if (!mapFile(&rom, name.c_str()) || rom.size != entry.size)
+                    return false;
+                *data = rom.data;
+                return true; });
+        unmapFile(&rom);
+    }
+    closeLibrary(&old);
+    if (paths.empty())
+        paths.push_back('\0');
+
+    std::sort(entries.begin(), entries.end(), [](const library_entry_t &a, const library_entry_t &b)
+              { return a.hash < b.hash; });
+    library_header_t header = {{'C', '8', 'L', 'B'}, LIBRARY_VERSION, sizeof(library_entry_t), (uint32_t)entries.size(), 0, (uint32_t)paths.size(), 0};
+    header.paths = sizeof header + entries.size() * sizeof(library_entry_t);
+
+    // Write next to the index and rename over it, readers keep their mapping of the old file
+    const std::string temp = std::string(index_path) + ".tmp";
+    FILE *out = fopen(temp.c_str(), "wb");
+    if (!out || fwrite(&header, sizeof header, 1, out) != 1 ||
+        (!entries.empty() && fwrite(entries.data(), sizeof(library_entry_t), entries.size(), out) != entries.size()) ||
+        fwrite(paths.data(), 1, paths.size(), out) != paths.size())
+    {
+        std::cout << "Could not write ROM library " << index_path << "\n";
+        if (out)
+            fclose(out);
+        return false;
+    }
+    fclose(out);
+    std::filesystem::rename(temp, index_path, error);
+    if (error)
+    {
+        std::cout << "Could not write ROM library " << index_path << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Comma separated quirk names of "quirks" into "out"
+void formatQuirks(uint8_t quirks, char *out, size_t size)
+{
+    std::string text;
+    for (uint8_t i = 0; i < QUIRK_COUNT; i++)
+        if (quirks & (1 << i))
+            text += (text.empty() ? "" : ",") + std::string(quirk_names[i]);
+    snprintf(out, size, "%s", text.empty() ? "-" : text.c_str());
+}
+
+// Look "rom_name" up in the library at "path": run it at the recommended speed unless --ips was given, and
+// name the quirks its code relies on that the core emulates differently from its platform
+bool applyLibrary(config_t *config, const char *path, const char *rom_name)
+{
+    library_t library;
+    if (!openLibrary(&library, path))
+        return false;
+    const library_entry_t *entry = libraryLookup(&library, rom_name);
+    if (!entry)
+    {
+        std::cout << "ROM " << rom_name << " is not in the library " << path << "\n";
+        closeLibrary(&library);
+        return false;
+    }
+    if (!config->ips_set)
+        config->insts_per_second = entry->ips;
+    const uint8_t differ = entry->sensitive & (entry->quirks ^ CORE_QUIRKS);
+    if (differ)
+    {
+        char names[128];
+        formatQuirks(differ, names, sizeof names);
+        std::cout << platform_names[entry->platform] << " ROM, quirks emulated differently: " << names << "\n";
+    }
+    closeLibrary(&library);
+    return true;
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <stdio.h>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN // keeps winsock.h out, chip8_stream.h needs winsock2.h
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory mapped file. Pages are shared with the OS file cache and every other process or thread
+// mapping the same file; nothing is read until it is touched.
+typedef struct
+{
+    const uint8_t *data; // NULL for an empty file
+    size_t size;
+#if defined(_WIN32)
+    HANDLE file;
+    HANDLE mapping;
+#endif
+} mapped_file_t;
+
+bool mapFile(mapped_file_t *map, const char *path)
+{
+    memset(map, 0, sizeof *map);
+#if defined(_WIN32)
+    map->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (map->file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(map->file, &size))
+    {
+        CloseHandle(map->file);
+        return false;
+    }
+    map->size = (size_t)size.QuadPart;
+    if (map->size)
+    {
+        map->mapping = CreateFileMappingA(map->file, NULL, PAGE_READONLY, 0, 0, NULL);
+        map->data = map->mapping ? (const uint8_t *)MapViewOfFile(map->mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+        if (!map->data)
+        {
+            if (map->mapping)
+                CloseHandle(map->mapping);
+            CloseHandle(map->file);
+            return false;
+        }
+    }
+#else
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+    {
+        close(fd);
+        return false;
+    }
+    map->size = (size_t)info.st_size;
+    if (map->size)
+    {
+        void *data = mmap(NULL, map->size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            close(fd);
+            return false;
+        }
+        map->data = (const uint8_t *)data;
+    }
+    close(fd); // the mapping keeps the file alive
+#endif
+    return true;
+}
+
+void unmapFile(mapped_file_t *map)
+{
+#if defined(_WIN32)
+    if (map->data)
+        UnmapViewOfFile(map->data);
+    if (map->mapping)
+        CloseHandle(map->mapping);
+    if (map->file && map->file != INVALID_HANDLE_VALUE)
+        CloseHandle(map->file);
+#else
+    if (map->data)
+        munmap((void *)map->data, map->size);
+#endif
+    memset(map, 0, sizeof *map);
+}
@@ -0,0 +1,402 @@
+#pragma once
+#include <stdio.h>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <chrono>
+
+#include "chip8_core.h"
+#include "chip8_state.h"
+#include "chip8_input.h"
+#include "chip8_stream.h" // socket_t, setNonBlocking
+
+#if defined(_WIN32)
+#include <ws2tcpip.h>
+#else
+#include <netdb.h>
+#include <sys/select.h>
+#endif
+
+// Two player netplay with rollback. Both peers run the same ROM, seed and speed and send each other their keys
+// every frame over UDP; the machine's keypad is both players' keys ORed together. A frame whose remote keys have
+// not arrived runs on a prediction (the last remote keys received), with a snapshot of the machine taken before
+// it. When the real keys turn out different, the peer restores the snapshot of that frame and emulates up to the
+// present again. A peer never gets more than the rollback window ahead of the remote keys it has (it waits for
+// the other one instead), so no rollback is longer than the window.
+// Packets, little endian:
+//   'H' hello:  u64 hash of the booted machine (ROM and seed), u32 instructions per second; sent until answered
+//   'F' frames: u32 next remote frame wanted (acks the ones before), u32 first frame, u8 count, count x u16 keys
+//               (our keys for every frame the peer hasn't acked), then u32 frame and u64 hash of the machine before
+//               that frame, for the newest frame whose keys both peers have, so a desync is noticed
+//   'B' bye:    the peer has stopped, its last keys stay held
+#define NETPLAY_MAX_ROLLBACK 30
+#define NETPLAY_HISTORY 64 // frames of keys and snapshots kept, more than twice the longest rollback window
+#define NETPLAY_TIMEOUT_MS 5000
+#define NETPLAY_CONNECT_MS 30000
+
+typedef struct
+{
+    bool connected; // false for a zeroed netplay_t
+    socket_t socket;
+    sockaddr_in peer;
+    uint32_t window; // rollback window, frames
+    uint8_t hello[13];
+
+    uint32_t frame;       // next frame to emulate
+    uint32_t remote_next; // the peer's keys are known for every frame before this one
+    uint32_t acked;       // the peer has our keys for every frame before this one
+    bool peer_left;
+    uint16_t local[NETPLAY_HISTORY];    // our keys per frame
+    uint16_t remote[NETPLAY_HISTORY];   // the peer's keys per frame, real or predicted
+    chip8_t snapshots[NETPLAY_HISTORY]; // machine before each frame
+    uint32_t rollback_from;             // earliest mispredicted frame, UINT32_MAX if none
+    uint32_t checked;                   // newest frame compared with the peer's hash
+    bool desync;
+    std::chrono::steady_clock::time_point last_packet;
+
+    // stats
+    uint32_t rollbacks;
+    uint32_t resimulated; // frames emulated again after mispredictions
+    uint32_t longest;     // longest rollback, frames
+    uint32_t waits;       // frames held back until the peer caught up
+} netplay_t;
+
+// Wait up to "ms" for a packet
+void waitPacket(netplay_t *netplay, uint32_t ms)
+{
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(netplay->socket, &readable);
+    timeval timeout = {0, (long)ms * 1000};
+    select((int)netplay->socket + 1, &readable, NULL, NULL, &timeout);
+}
+
+// Next packet from the peer, its size or 0 if none is waiting
+size_t receivePacket(netplay_t *netplay, uint8_t *packet, size_t size)
+{
+    for (;;)
+    {
+        sockaddr_in from = {};
+        socklen_t from_size = sizeof from;
+        const int got = recvfrom(netplay->socket, (char *)packet, (int)size, 0, (sockaddr *)&from, &from_size);
+        if (got < 0)
+            return 0; // nothing waiting, or on Windows an ICMP port unreachable from a peer that isn't up yet
+        if (got > 0 && from.sin_addr.s_addr == netplay->peer.sin_addr.s_addr && from.sin_port == netplay->peer.sin_port)
+            return (size_t)got;
+    }
+}
+
+void sendPacket(netplay_t *netplay, const uint8_t *packet, size_t size)
+{
+    sendto(netplay->socket, (const char *)packet, (int)size, 0, (const sockaddr *)&netplay->peer, sizeof netplay->peer);
+}
+
+// Our keys the peer hasn't acked, and the hash of the newest snapshot both peers have every key before. Nothing
+// once the peer has left, it acks nothing more.
+void sendFrames(netplay_t *netplay)
+{
+    static_assert(NETPLAY_HISTORY <= 255, "key count is a u8");
+    if (netplay->peer_left)
+        return;
+    // keys older than the history are gone anyway, a peer that far behind has stopped
+    const uint32_t first = netplay->frame - netplay->acked > NETPLAY_HISTORY ? netplay->frame - NETPLAY_HISTORY : netplay->acked;
+    uint8_t packet[1 + 4 + 4 + 1 + 2 * NETPLAY_HISTORY + 4 + 8];
+    uint8_t *out = packet;
+    *out++ = 'F';
+    put32(&out, netplay->remote_next);
+    put32(&out, first);
+    *out++ = (uint8_t)(netplay->frame - first);
+    for (uint32_t frame = first; frame < netplay->frame; frame++)
+        put16(&out, netplay->local[frame % NETPLAY_HISTORY]);
+
+    uint32_t check = UINT32_MAX;
+    uint64_t hash = 0;
+    if (netplay->frame)
+    {
+        check = netplay->remote_next < netplay->frame - 1 ? netplay->remote_next : netplay->frame - 1;
+        hash = hashChip8(&netplay->snapshots[check % NETPLAY_HISTORY]);
+    }
+    put32(&out, check);
+    put32(&out, (uint32_t)hash);
+    put32(&out, (uint32_t)(hash >> 32));
+    sendPacket(netplay, packet, out - packet);
+}
+
+// Take in the peer's keys and acks, noting the earliest frame that ran on a wrong prediction
+void readFrames(netplay_t *netplay, const uint8_t *packet, size_t size)
+{
+    if (size < 10 || size != 10 + 2 * (size_t)packet[9] + 12)
+        return;
+    const uint8_t *in = packet + 1;
+    const uint32_t acked = get32(&in);
+    if (acked > netplay->acked && acked <= netplay->frame)
+        netplay->acked = acked;
+    const uint32_t first = get32(&in);
+    const uint32_t count = *in++;
+    for (uint32_t frame = first; frame < first + count; frame++)
+    {
+        const uint16_t keys = get16(&in);
+        if (frame != netplay->remote_next || frame >= netplay->frame + NETPLAY_HISTORY - 1)
+            continue; // already known, or past a gap a later packet fills
+        const uint32_t slot = frame % NETPLAY_HISTORY;
+        if (frame < netplay->frame && netplay->remote[slot] != keys && frame < netplay->rollback_from)
+            netplay->rollback_from = frame;
+        netplay->remote[slot] = keys;
+        netplay->remote_next++;
+    }
+
+    // compare once our snapshot of that frame is final too, and still kept
+    const uint32_t check = get32(&in);
+    uint64_t hash = get32(&in);
+    hash |= (uint64_t)get32(&in) << 32;
+    if (check == UINT32_MAX || (netplay->checked && check <= netplay->checked) || check > netplay->remote_next ||
+        check >= netplay->rollback_from || check >= netplay->frame || check + NETPLAY_HISTORY < netplay->frame)
+        return;
+    netplay->checked = check;
+    if (!netplay->desync && hashChip8(&netplay->snapshots[check % NETPLAY_HISTORY]) != hash)
+    {
+        std::cout << "Netplay out of sync with the peer at frame " << check << "\n";
+        netplay->desync = true;
+    }
+}
+
+// Handle every packet waiting, false if the peer has gone quiet
+bool pollNetplay(netplay_t *netplay)
+{
+    uint8_t packet[1500];
+    size_t size;
+    while ((size = receivePacket(netplay, packet, sizeof packet)) > 0)
+    {
+        netplay->last_packet = std::chrono::steady_clock::now();
+        if (packet[0] == 'H') // the peer missed our answer to its hello
+            sendPacket(netplay, netplay->hello, sizeof netplay->hello);
+        else if (packet[0] == 'F')
+            readFrames(netplay, packet, size);
+        else if (packet[0] == 'B' && !netplay->peer_left)
+        {
+            std::cout << "Netplay peer left at frame " << netplay->remote_next << "\n";
+            netplay->peer_left = true;
+        }
+    }
+    if (!netplay->peer_left && elapsedMs(netplay->last_packet) > NETPLAY_TIMEOUT_MS)
+    {
+        std::cout << "Netplay peer timed out\n";
+        netplay->peer_left = true;
+        return false;
+    }
+    return true;
+}
+
+// The peer's keys in "frame": real if received, otherwise the last ones received
+uint16_t remoteKeys(const netplay_t *netplay, uint32_t frame)
+{
+    if (frame < netplay->remote_next)
+        return netplay->remote[frame % NETPLAY_HISTORY];
+    return netplay->remote_next ? netplay->remote[(netplay->remote_next - 1) % NETPLAY_HISTORY] : 0;
+}
+
+// Snapshot the machine and emulate "frame" with both players' keys
+void netplayStep(netplay_t *netplay, chip8_t *chip8, const config_t config, audio_t *audio, uint32_t frame)
+{
+    const uint32_t slot = frame % NETPLAY_HISTORY;
+    netplay->remote[slot] = remoteKeys(netplay, frame);
+    netplay->snapshots[slot] = *chip8;
+    setKeypad(chip8, netplay->local[slot] | netplay->remote[slot]);
+    emulateFrame(chip8, config, audio);
+}
+
+// Go back to the earliest mispredicted frame and emulate up to the present with the keys known now. Frames
+// emulated again make no sound and leave no trace or profile, their first run already did.
+void rollbackNetplay(netplay_t *netplay, chip8_t *chip8, const config_t config)
+{
+    const uint32_t from = netplay->rollback_from;
+    netplay->rollback_from = UINT32_MAX;
+    if (from >= netplay->frame)
+        return;
+    const emulator_state_t state = chip8->state; // quit or pause since then still holds
+    *chip8 = netplay->snapshots[from % NETPLAY_HISTORY];
+#ifdef DEBUG
+    tracer_t *tracer = chip8->tracer;
+    chip8->tracer = NULL;
+#endif
+#ifdef PROFILE
+    profile_t *profile = chip8->profile;
+    chip8->profile = NULL;
+#endif
+    for (uint32_t frame = from; frame < netplay->frame; frame++)
+        netplayStep(netplay, chip8, config, NULL, frame);
+#ifdef DEBUG
+    chip8->tracer = tracer;
+#endif
+#ifdef PROFILE
+    chip8->profile = profile;
+#endif
+    chip8->state = state;
+
+    const uint32_t frames = netplay->frame - from;
+    netplay->rollbacks++;
+    netplay->resimulated += frames;
+    if (frames > netplay->longest)
+        netplay->longest = frames;
+}
+
+// Emulate the next frame, our keys taken from the keypad. False if it had to wait for the peer and "wait" is
+// false (windowed runs try again next frame), or if the peer is gone, which also quits.
+bool netplayFrame(netplay_t *netplay, chip8_t *chip8, const config_t config, audio_t *audio, bool wait)
+{
+    const uint16_t local = getKeypad(chip8);
+    bool waited = false;
+    for (;;)
+    {
+        if (!pollNetplay(netplay))
+        {
+            chip8->state = QUIT;
+            return false;
+        }
+        rollbackNetplay(netplay, chip8, config);
+        if (netplay->peer_left || netplay->frame < netplay->remote_next + netplay->window)
+            break;
+        if (!waited)
+            netplay->waits++;
+        waited = true;
+        sendFrames(netplay); // in case ours went missing
+        setKeypad(chip8, local);
+        if (!wait)
+            return false;
+        waitPacket(netplay, 1);
+    }
+
+    netplay->local[netplay->frame % NETPLAY_HISTORY] = local;
+    netplayStep(netplay, chip8, config, audio, netplay->frame);
+    netplay->frame++;
+    sendFrames(netplay);
+    setKeypad(chip8, local); // the next frame starts from our keys again
+    return true;
+}
+
+// Settle the last frames with the peer (both sides end up on the same final machine), say bye and report
+void stopNetplay(netplay_t *netplay, chip8_t *chip8, const config_t config)
+{
+    if (!netplay->connected)
+        return;
+    while (!netplay->peer_left && (netplay->acked < netplay->frame || netplay->remote_next < netplay->frame))
+    {
+        sendFrames(netplay);
+        waitPacket(netplay, 10);
+        if (!pollNetplay(netplay))
+            break;
+        rollbackNetplay(netplay, chip8, config);
+    }
+    const uint8_t bye = 'B';
+    for (int i = 0; i < 3; i++)
+        sendPacket(netplay, &bye, 1);
+
+    printf("Netplay: %u frames, %u rollbacks re-emulating %u frames (longest %u), %u frames waiting for the peer, final state %016llx\n",
+           netplay->frame, netplay->rollbacks, netplay->resimulated, netplay->longest, netplay->waits,
+           (unsigned long long)hashChip8(chip8));
+    closeSocket(netplay->socket);
+    netplay->socket = INVALID_SOCKET;
+    netplay->connected = false;
+#if defined(_WIN32)
+    WSACleanup();
+#endif
+}
+
+// Open "<local port>:<peer host>:<peer port>" and wait for the peer to boot the same machine
+bool startNetplay(netplay_t *netplay, const char *address, uint32_t window, const chip8_t *boot, const config_t config)
+{
+    netplay->connected = false;
+    netplay->socket = INVALID_SOCKET;
+    netplay->window = window < 1 ? 1 : window > NETPLAY_MAX_ROLLBACK ? NETPLAY_MAX_ROLLBACK : window;
+    netplay->frame = netplay->remote_next = netplay->acked = 0;
+    netplay->peer_left = false;
+    netplay->rollback_from = UINT32_MAX;
+    netplay->checked = 0;
+    netplay->desync = false;
+    netplay->rollbacks = netplay->resimulated = netplay->longest = netplay->waits = 0;
+#if defined(_WIN32)
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0)
+    {
+        std::cout << "Could not start Winsock\n";
+        return false;
+    }
+#endif
+
+    const char *host_start = strchr(address, ':');
+    const char *peer_port = strrchr(address, ':');
+    char host[256];
+    if (!host_start || peer_port == host_start || (size_t)(peer_port - host_start) > sizeof host)
+    {
+        std::cout << "Netplay address " << address << " should be <local port>:<peer host>:<peer port>\n";
+        return false;
+    }
+    memcpy(host, host_start + 1, peer_port - host_start - 1);
+    host[peer_port - host_start - 1] = '\0';
+    addrinfo hints = {}, *found = NULL;
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(host, peer_port + 1, &hints, &found) != 0)
+    {
+        std::cout << "Netplay peer " << host << " not found\n";
+        return false;
+    }
+    memcpy(&netplay->peer, found->ai_addr, sizeof netplay->peer);
+    freeaddrinfo(found);
+
+    sockaddr_in local = {};
+    local.sin_family = AF_INET;
+    local.sin_port = htons((uint16_t)strtol(address, NULL, 10));
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    netplay->socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (netplay->socket == INVALID_SOCKET || bind(netplay->socket, (const sockaddr *)&local, sizeof local) != 0 ||
+        !setNonBlocking(netplay->socket))
+    {
+        std::cout << "Could not open netplay port " << strtol(address, NULL, 10) << "\n";
+        if (netplay->socket != INVALID_SOCKET)
+            closeSocket(netplay->socket);
+        netplay->socket = INVALID_SOCKET;
+        return false;
+    }
+
+    uint8_t *out = netplay->hello;
+    *out++ = 'H';
+    const uint64_t hash = hashChip8(boot);
+    put32(&out, (uint32_t)hash);
+    put32(&out, (uint32_t)(hash >> 32));
+    put32(&out, config.insts_per_second);
+
+    // hello until the peer's arrives, it may start later
+    std::cout << "Netplay waiting for " << host << ":" << peer_port + 1 << "\n";
+    const auto start = std::chrono::steady_clock::now();
+    while (elapsedMs(start) < NETPLAY_CONNECT_MS)
+    {
+        sendPacket(netplay, netplay->hello, sizeof netplay->hello);
+        waitPacket(netplay, 100);
+        uint8_t packet[1500];
+        size_t size;
+        while ((size = receivePacket(netplay, packet, sizeof packet)) > 0)
+        {
+            if (packet[0] != 'H')
+                continue; // frames from a peer that already has our hello, its answer to the next one follows
+            if (size != sizeof netplay->hello || memcmp(packet, netplay->hello, size) != 0)
+            {
+                std::cout << "Netplay peer runs a different ROM, seed or speed\n";
+                sendPacket(netplay, netplay->hello, sizeof netplay->hello); // so the peer finds out too
+                break;
+            }
+            sendPacket(netplay, netplay->hello, sizeof netplay->hello); // in case ours went missing
+            netplay->last_packet = std::chrono::steady_clock::now();
+            netplay->connected = true;
+            std::cout << "Netplay connected, rollback window " << netplay->window << " frames\n";
+            return true;
+        }
+        if (size)
+            break;
+    }
+    if (elapsedMs(start) >= NETPLAY_CONNECT_MS)
+        std::cout << "Netplay peer did not answer\n";
+    closeSocket(netplay->socket);
+    netplay->socket = INVALID_SOCKET;
+    return false;
+}
@@ -0,0 +1,163 @@
+#pragma once
+#include <stdio.h>
+#include <cstdint>
+#include <cstring>
+
+// Opcode classes, one per distinct instruction the core emulates plus a catch-all per group for
+// opcodes it ignores.
+typedef enum
+{
+    OP_00E0, OP_00EE, OP_0NNN,
+    OP_1NNN, OP_2NNN, OP_3XNN, OP_4XNN, OP_5XY0, OP_6XNN, OP_7XNN,
+    OP_8XY0, OP_8XY1, OP_8XY2, OP_8XY3, OP_8XY4, OP_8XY5, OP_8XY6, OP_8XY7, OP_8XYE, OP_8XYN,
+    OP_9XY0, OP_ANNN, OP_BNNN, OP_CXNN, OP_DXYN,
+    OP_EX9E, OP_EXA1, OP_EXNN,
+    OP_F002, OP_FX07, OP_FX0A, OP_FX15, OP_FX18, OP_FX1E, OP_FX29, OP_FX33, OP_FX3A, OP_FX55, OP_FX65, OP_FXNN,
+    OP_CLASSES,
+} opcode_class_t;
+
+// How an instruction passes control on
+typedef enum
+{
+    FLOW_NEXT,     // next instruction
+    FLOW_JUMP,     // NNN
+    FLOW_CALL,     // NNN, returns to the next instruction
+    FLOW_RETURN,   // top of stack
+    FLOW_SKIP,     // next or the one after
+    FLOW_INDIRECT, // V0 + NNN, unknown statically
+} opcode_flow_t;
+
+// Per class decode table shared by the debug output, profiler, benchmarks and disassembler.
+// "format" is the assembler mnemonic, {X} {Y} {N} {NN} {NNN} are replaced by the opcode fields, {OP} by the opcode.
+typedef struct
+{
+    const char *name;
+    const char *format;
+    const char *description;
+    opcode_flow_t flow;
+} opcode_info_t;
+
+const opcode_info_t opcode_info[OP_CLASSES] = {
+    {"00E0", "CLS", "Clear screen", FLOW_NEXT},
+    {"00EE", "RET", "Return from subroutine", FLOW_RETURN},
+    {"0NNN", "SYS 0x{NNN}", "Unimplemented Opcode.", FLOW_NEXT},
+    {"1NNN", "JP 0x{NNN}", "Jump to address NNN", FLOW_JUMP},
+    {"2NNN", "CALL 0x{NNN}", "Call subroutine at NNN", FLOW_CALL},
+    {"3XNN", "SE V{X}, 0x{NN}", "Skip next instruction if VX == NN", FLOW_SKIP},
+    {"4XNN", "SNE V{X}, 0x{NN}", "Skip next instruction if VX != NN", FLOW_SKIP},
+    {"5XY0", "SE V{X}, V{Y}", "Skip next instruction if VX == VY", FLOW_SKIP},
+    {"6XNN", "LD V{X}, 0x{NN}", "Set register VX = NN", FLOW_NEXT},
+    {"7XNN", "ADD V{X}, 0x{NN}", "Set register VX += NN", FLOW_NEXT},
+    {"8XY0", "LD V{X}, V{Y}", "Set register VX = VY", FLOW_NEXT},
+    {"8XY1", "OR V{X}, V{Y}", "Set register VX |= VY", FLOW_NEXT},
+    {"8XY2", "AND V{X}, V{Y}", "Set register VX &= VY", FLOW_NEXT},
+    {"8XY3", "XOR V{X}, V{Y}", "Set register VX ^= VY", FLOW_NEXT},
+    {"8XY4", "ADD V{X}, V{Y}", "Set register VX += VY, VF = 1 if carry", FLOW_NEXT},
+    {"8XY5", "SUB V{X}, V{Y}", "Set register VX -= VY, VF = 1 if no borrow", FLOW_NEXT},
+    {"8XY6", "SHR V{X}", "Set register VX >>= 1, VF = shifted off bit", FLOW_NEXT},
+    {"8XY7", "SUBN V{X}, V{Y}", "Set register VX = VY - VX, VF = 1 if no borrow", FLOW_NEXT},
+    {"8XYE", "SHL V{X}", "Set register VX <<= 1, VF = shifted off bit", FLOW_NEXT},
+    {"8XYN", "DW 0x{OP}", "Invalid opcode", FLOW_NEXT},
+    {"9XY0", "SNE V{X}, V{Y}", "Skip next instruction if VX != VY", FLOW_SKIP},
+    {"ANNN", "LD I, 0x{NNN}", "Set I to NNN", FLOW_NEXT},
+    {"BNNN", "JP V0, 0x{NNN}", "Set PC to V0 + NNN", FLOW_INDIRECT},
+    {"CXNN", "RND V{X}, 0x{NN}", "Set VX = rand() % 256 & NN", FLOW_NEXT},
+    {"DXYN", "DRW V{X}, V{Y}, {N}", "Draw N height sprite at coords VX, VY from memory location I", FLOW_NEXT},
+    {"EX9E", "SKP V{X}", "Skip next instruction if key in VX is pressed", FLOW_SKIP},
+    {"EXA1", "SKNP V{X}", "Skip next instruction if key in VX is not pressed", FLOW_SKIP},
+    {"EXNN", "DW 0x{OP}", "Invalid opcode", FLOW_NEXT},
+    {"F002", "AUDIO", "Load audio pattern from memory at I", FLOW_NEXT},
+    {"FX07", "LD V{X}, DT", "Set VX = delay timer value", FLOW_NEXT},
+    {"FX0A", "LD V{X}, K", "Await until a key is pressed; Store key in VX", FLOW_NEXT},
+    {"FX15", "LD DT, V{X}", "Set delay timer value = VX", FLOW_NEXT},
+    {"FX18", "LD ST, V{X}", "Set sound timer value = VX", FLOW_NEXT},
+    {"FX1E", "ADD I, V{X}", "I += VX", FLOW_NEXT},
+    {"FX29", "LD F, V{X}", "Set I to sprite location in memory for character in VX", FLOW_NEXT},
+    {"FX33", "LD B, V{X}", "Store BCD representation of VX at memory from I", FLOW_NEXT},
+    {"FX3A", "PITCH V{X}", "Set audio pitch = VX", FLOW_NEXT},
+    {"FX55", "LD [I], V{X}", "Register dump V0-VX inclusive at memory from I", FLOW_NEXT},
+    {"FX65", "LD V{X}, [I]", "Register load V0-VX inclusive at memory from I", FLOW_NEXT},
+    {"FXNN", "DW 0x{OP}", "Invalid opcode", FLOW_NEXT},
+};
+
+opcode_class_t opcodeClass(uint16_t opcode)
+{
+    const uint8_t NN = opcode & 0xFF;
+    switch (opcode >> 12)
+    {
+    case 0x0:
+        return NN == 0xE0 ? OP_00E0 : NN == 0xEE ? OP_00EE : OP_0NNN; // the core ignores the middle nibble
+    case 0x1: return OP_1NNN;
+    case 0x2: return OP_2NNN;
+    case 0x3: return OP_3XNN;
+    case 0x4: return OP_4XNN;
+    case 0x5: return OP_5XY0;
+    case 0x6: return OP_6XNN;
+    case 0x7: return OP_7XNN;
+    case 0x8:
+        switch (opcode & 0xF)
+        {
+        case 0x0: return OP_8XY0;
+        case 0x1: return OP_8XY1;
+        case 0x2: return OP_8XY2;
+        case 0x3: return OP_8XY3;
+        case 0x4: return OP_8XY4;
+        case 0x5: return OP_8XY5;
+        case 0x6: return OP_8XY6;
+        case 0x7: return OP_8XY7;
+        case 0xE: return OP_8XYE;
+        default: return OP_8XYN;
+        }
+    case 0x9: return OP_9XY0;
+    case 0xA: return OP_ANNN;
+    case 0xB: return OP_BNNN;
+    case 0xC: return OP_CXNN;
+    case 0xD: return OP_DXYN;
+    case 0xE:
+        return NN == 0x9E ? OP_EX9E : NN == 0xA1 ? OP_EXA1 : OP_EXNN;
+    default:
+        switch (NN)
+        {
+        case 0x02: return (opcode & 0x0F00) ? OP_FXNN : OP_F002;
+        case 0x07: return OP_FX07;
+        case 0x0A: return OP_FX0A;
+        case 0x15: return OP_FX15;
+        case 0x18: return OP_FX18;
+        case 0x1E: return OP_FX1E;
+        case 0x29: return OP_FX29;
+        case 0x33: return OP_FX33;
+        case 0x3A: return OP_FX3A;
+        case 0x55: return OP_FX55;
+        case 0x65: return OP_FX65;
+        default: return OP_FXNN;
+        }
+    }
+}
+
+// Assembler text of "opcode" into "out"
+void formatOpcode(uint16_t opcode, char *out, size_t size)
+{
+    const char *format = opcode_info[opcodeClass(opcode)].format;
+    size_t length = 0;
+    while (*format && length + 1 < size)
+    {
+        char field[8] = "";
+        if (strncmp(format, "{X}", 3) == 0)
+            snprintf(field, sizeof field, "%X", (opcode >> 8) & 0xF), format += 3;
+        else if (strncmp(format, "{Y}", 3) == 0)
+            snprintf(field, sizeof field, "%X", (opcode >> 4) & 0xF), format += 3;
+        else if (strncmp(format, "{N}", 3) == 0)
+            snprintf(field, sizeof field, "%u", opcode & 0xF), format += 3;
+        else if (strncmp(format, "{NN}", 4) == 0)
+            snprintf(field, sizeof field, "%02X", opcode & 0xFF), format += 4;
+        else if (strncmp(format, "{NNN}", 5) == 0)
+            snprintf(field, sizeof field, "%03X", opcode & 0xFFF), format += 5;
+        else if (strncmp(format, "{OP}", 4) == 0)
+            snprintf(field, sizeof field, "%04X", opcode), format += 4;
+        else
+            field[0] = *format++;
+        for (const char *c = field; *c && length + 1 < size; c++)
+            out[length++] = *c;
+    }
+    out[length] = '\0';
+}
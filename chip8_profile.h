@@ -0,0 +1,143 @@
+#pragma once
+#include <stdio.h>
+#include <cstdlib>
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <vector>
+#include <unordered_map>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "chip8.h"
+#include "chip8_opcodes.h"
+
+// Execution profile (PROFILE builds): instructions and host time per opcode class, instructions per PC and
+// taken backward jumps, i.e. loop iterations, per (loop end, loop start) pair.
+struct profile_t
+{
+    uint64_t count[OP_CLASSES];
+    uint64_t ticks[OP_CLASSES]; // host clock ticks spent in emulateInstruction
+    uint64_t pc_count[4096];
+    std::unordered_map<uint32_t, uint64_t> loops; // from << 12 | to -> iterations
+    uint16_t opcodes[4096]; // last opcode seen at each PC, for the report
+
+    uint64_t start_ticks; // tick rate calibration
+    std::chrono::steady_clock::time_point start_time;
+};
+
+// Host clock: time stamp counter where there is one
+uint64_t profileTicks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void initProfile(profile_t *profile)
+{
+    memset(profile->count, 0, sizeof profile->count);
+    memset(profile->ticks, 0, sizeof profile->ticks);
+    memset(profile->pc_count, 0, sizeof profile->pc_count);
+    memset(profile->opcodes, 0, sizeof profile->opcodes);
+    profile->loops.clear();
+    profile->start_ticks = profileTicks();
+    profile->start_time = std::chrono::steady_clock::now();
+}
+
+// Count an executed instruction; "pc" is its address, "next" the PC after it ran
+void profileInstruction(profile_t *profile, uint16_t pc, uint16_t opcode, uint16_t next, uint64_t ticks)
+{
+    const opcode_class_t op = opcodeClass(opcode);
+    profile->count[op]++;
+    profile->ticks[op] += ticks;
+    profile->pc_count[pc & 0xFFF]++;
+    profile->opcodes[pc & 0xFFF] = opcode;
+    // Jumps and skips landing at or before themselves close a loop (calls and returns don't)
+    if (next <= pc && op != OP_2NNN && op != OP_00EE)
+        profile->loops[(uint32_t)(pc & 0xFFF) << 12 | (next & 0xFFF)]++;
+}
+
+// Print the hot-spot report to stdout and write every counter to "csv_path"
+void reportProfile(const profile_t *profile, const char *csv_path, uint32_t top)
+{
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - profile->start_time).count();
+    const uint64_t elapsed = profileTicks() - profile->start_ticks;
+    const double ns_per_tick = elapsed ? ns / elapsed : 1;
+
+    uint64_t total = 0, total_ticks = 0;
+    for (uint32_t i = 0; i < OP_CLASSES; i++)
+    {
+        total += profile->count[i];
+        total_ticks += profile->ticks[i];
+    }
+    if (!total)
+        return;
+
+    // Opcode classes by host time
+    std::vector<uint32_t> ops;
+    for (uint32_t i = 0; i < OP_CLASSES; i++)
+        if (profile->count[i])
+            ops.push_back(i);
+    std::sort(ops.begin(), ops.end(), [&](uint32_t a, uint32_t b)
+              { return profile->ticks[a] > profile->ticks[b]; });
+    printf("%llu instructions, %.1f ms in the core\n\n", (unsigned long long)total, total_ticks * ns_per_tick / 1e6);
+    printf("class        count      %%      ms  ns/inst\n");
+    for (uint32_t i : ops)
+        printf("%s  %12llu  %5.1f  %6.2f  %7.1f\n", opcode_info[i].name, (unsigned long long)profile->count[i],
+               100.0 * profile->count[i] / total, profile->ticks[i] * ns_per_tick / 1e6,
+               profile->ticks[i] * ns_per_tick / profile->count[i]);
+
+    // Hottest addresses
+    std::vector<uint16_t> pcs;
+    for (uint16_t pc = 0; pc < 4096; pc++)
+        if (profile->pc_count[pc])
+            pcs.push_back(pc);
+    std::sort(pcs.begin(), pcs.end(), [&](uint16_t a, uint16_t b)
+              { return profile->pc_count[a] > profile->pc_count[b]; });
+    printf("\naddress  opcode         count      %%\n");
+    for (uint32_t i = 0; i < pcs.size() && i < top; i++)
+        printf("0x%03X    0x%04X  %12llu  %5.1f\n", pcs[i], profile->opcodes[pcs[i]],
+               (unsigned long long)profile->pc_count[pcs[i]], 100.0 * profile->pc_count[pcs[i]] / total);
+
+    // Loops by instructions executed inside them (every pass over the loop body, including the last)
+    typedef struct
+    {
+        uint16_t from, to;
+        uint64_t iterations, instructions;
+    } loop_t;
+    std::vector<loop_t> loops;
+    for (const auto &entry : profile->loops)
+    {
+        loop_t loop = {(uint16_t)(entry.first >> 12), (uint16_t)(entry.first & 0xFFF), entry.second, 0};
+        for (uint16_t pc = loop.to; pc <= loop.from; pc++)
+            loop.instructions += profile->pc_count[pc];
+        loops.push_back(loop);
+    }
+    std::sort(loops.begin(), loops.end(), [](const loop_t &a, const loop_t &b)
+              { return a.instructions > b.instructions; });
+    printf("\nloop           iterations  instructions      %%\n");
+    for (uint32_t i = 0; i < loops.size() && i < top; i++)
+        printf("0x%03X-0x%03X  %12llu  %12llu  %5.1f\n", loops[i].to, loops[i].from,
+               (unsigned long long)loops[i].iterations, (unsigned long long)loops[i].instructions,
+               100.0 * loops[i].instructions / total);
+
+    FILE *csv = fopen(csv_path, "w");
+    if (!csv)
+    {
+        std::cout << "Could not write profile " << csv_path << "\n";
+        return;
+    }
+    fprintf(csv, "kind,key,opcode,count,ns\n");
+    for (uint32_t i : ops)
+        fprintf(csv, "class,%s,,%llu,%.0f\n", opcode_info[i].name, (unsigned long long)profile->count[i],
+                profile->ticks[i] * ns_per_tick);
+    for (uint16_t pc : pcs)
+        fprintf(csv, "pc,0x%03X,0x%04X,%llu,\n", pc, profile->opcodes[pc], (unsigned long long)profile->pc_count[pc]);
+    for (const loop_t &loop : loops)
+        fprintf(csv, "loop,0x%03X-0x%03X,,%llu,\n", loop.to, loop.from, (unsigned long long)loop.iterations);
+    fclose(csv);
+}
@@ -0,0 +1,384 @@
+#pragma once
+#include <stdio.h>
+#include <cstring>
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+#include "chip8_core.h"
+
+// Video capture of the display in the fg/bg colors from config_t: uncompressed Y4M (4:4:4, 60 fps), an
+// animated GIF (".gif") or, for any other extension, raw RGB24 frames. The emulator packs each captured frame to 1 bit per pixel and hands it to
+// a writer thread through a single producer/single consumer ring. In real time it never waits on the writer, a
+// frame that finds the ring full is dropped (the previous frame is shown for longer, so the timing stays right);
+// offline (headless) capture waits instead and keeps every frame.
+// Identical consecutive frames, found by hash, travel as one frame with a repeat count and are converted once.
+#define RECORD_RING_SIZE 64     // frames, power of two
+#define RECORD_MAX_REPEAT 60    // frames a repeated frame is held back before it is handed to the writer
+#define RECORD_WIDTH 64
+#define RECORD_HEIGHT 32
+
+typedef enum
+{
+    RECORD_RAW,
+    RECORD_Y4M,
+    RECORD_GIF,
+} record_format_t;
+
+typedef struct
+{
+    uint8_t pixels[RECORD_WIDTH * RECORD_HEIGHT / 8]; // 1 bit per pixel, row major, bit 7 first
+    uint32_t repeat;                                  // consecutive 60Hz frames it is shown for
+} record_frame_t;
+
+// GIF encoder state, owned by the writer thread. A picture is written once the next one arrives and its display
+// time is known, as the rectangle that changed since the previous one on a "do not dispose" canvas.
+typedef struct
+{
+    uint8_t canvas[RECORD_WIDTH * RECORD_HEIGHT / 8];  // picture the frames written so far leave on screen
+    uint8_t pending[RECORD_WIDTH * RECORD_HEIGHT / 8]; // latest picture, not written yet
+    bool has_canvas;
+    bool has_pending;
+    uint64_t now;     // 60Hz frames received
+    uint64_t written; // centiseconds of frame delays written
+    uint16_t next[4096][2]; // LZW dictionary, code followed by color index -> code, 0 if absent
+} gif_t;
+
+struct recorder_t
+{
+    FILE *file;
+    record_format_t format;
+    bool lossless; // wait for the writer rather than drop frames
+    uint8_t fg[3]; // Y, U, V for Y4M, otherwise R, G, B
+    uint8_t bg[3];
+    gif_t *gif;
+    record_frame_t *ring; // RECORD_RING_SIZE frames
+    std::atomic<uint64_t> head; // frames published by the emulator
+    std::atomic<uint64_t> tail; // frames written by the writer thread
+    std::atomic<bool> running;
+    std::thread writer;
+
+    // emulator side
+    record_frame_t current; // latest frame, not yet published
+    uint64_t current_hash;
+    uint64_t frames;  // frames captured
+    uint64_t unique;  // frames converted and written at least once
+    uint64_t dropped; // frames lost to a full ring
+};
+
+bool gifPixel(const uint8_t *pixels, uint32_t x, uint32_t y)
+{
+    const uint32_t i = y * RECORD_WIDTH + x;
+    return (pixels[i / 8] >> (7 - i % 8)) & 1;
+}
+
+// LZW compress color indices into GIF image data sub-blocks. With two colors every code has two possible
+// extensions, so the dictionary is a plain table instead of a hash.
+void gifLzw(recorder_t *recorder, const uint8_t *indices, size_t count)
+{
+    const uint32_t min_size = 2, clear = 1 << min_size, end = clear + 1;
+    uint16_t(*next)[2] = recorder->gif->next;
+    uint8_t block[256];
+    uint32_t block_size = 0, bits = 0, bit_count = 0, code_size = min_size + 1, next_code = end + 1;
+
+    const auto emit = [&](uint32_t code)
+    {
+        bits |= code << bit_count;
+        for (bit_count += code_size; bit_count >= 8; bit_count -= 8, bits >>= 8)
+        {
+            block[1 + block_size++] = bits & 0xFF;
+            if (block_size == 255)
+            {
+                block[0] = 255;
+                fwrite(block, 1, 256, recorder->file);
+                block_size = 0;
+            }
+        }
+        // the decoder's table is one code behind, it widens its codes once it reaches this point
+        if (next_code >= (1u << code_size) && code_size < 12)
+            code_size++;
+    };
+
+    fputc(min_size, recorder->file);
+    memset(next, 0, sizeof recorder->gif->next);
+    emit(clear);
+    uint32_t prefix = indices[0];
+    for (size_t i = 1; i < count; i++)
+    {
+        const uint8_t color = indices[i];
+        if (next[prefix][color])
+        {
+            prefix = next[prefix][color];
+            continue;
+        }
+        emit(prefix);
+        if (next_code >= 4095) // table full, start over
+        {
+            emit(clear);
+            memset(next, 0, sizeof recorder->gif->next);
+            code_size = min_size + 1;
+            next_code = end + 1;
+        }
+        else
+            next[prefix][color] = next_code++;
+        prefix = color;
+    }
+    emit(prefix);
+    emit(end);
+    if (bit_count)
+        block[1 + block_size++] = bits & 0xFF;
+    if (block_size)
+    {
+        block[0] = block_size;
+        fwrite(block, 1, 1 + block_size, recorder->file);
+    }
+    fputc(0, recorder->file); // block terminator
+}
+
+// Write "pixels" as the next GIF frame, shown for "delay" centiseconds
+void gifWrite(recorder_t *recorder, const uint8_t *pixels, uint32_t delay)
+{
+    gif_t *gif = recorder->gif;
+
+    // bounding box of the pixels that differ from the canvas, the whole screen for the first frame
+    uint32_t x0 = RECORD_WIDTH, y0 = RECORD_HEIGHT, x1 = 0, y1 = 0;
+    for (uint32_t y = 0; y < RECORD_HEIGHT; y++)
+        for (uint32_t x = 0; x < RECORD_WIDTH; x++)
+            if (!gif->has_canvas || gifPixel(pixels, x, y) != gifPixel(gif->canvas, x, y))
+            {
+                x0 = x < x0 ? x : x0;
+                y0 = y < y0 ? y : y0;
+                x1 = x > x1 ? x : x1;
+                y1 = y > y1 ? y : y1;
+            }
+    if (x0 > x1) // nothing changed, one unchanged pixel carries the delay
+        x0 = y0 = x1 = y1 = 0;
+    const uint32_t width = x1 - x0 + 1, height = y1 - y0 + 1;
+
+    // graphic control extension (do not dispose, delay) and image descriptor (global palette)
+    const uint8_t header[] = {0x21, 0xF9, 4, 1 << 2, (uint8_t)(delay & 0xFF), (uint8_t)(delay >> 8), 0, 0,
+                              0x2C, (uint8_t)x0, 0, (uint8_t)y0, 0, (uint8_t)width, 0, (uint8_t)height, 0, 0};
+    fwrite(header, 1, sizeof header, recorder->file);
+
+    uint8_t indices[RECORD_WIDTH * RECORD_HEIGHT];
+    size_t count = 0;
+    for (uint32_t y = y0; y <= y1; y++)
+        for (uint32_t x = x0; x <= x1; x++)
+            indices[count++] = gifPixel(pixels, x, y);
+    gifLzw(recorder, indices, count);
+
+    memcpy(gif->canvas, pixels, sizeof gif->canvas);
+    gif->has_canvas = true;
+}
+
+// Take the next captured picture. The pending one is written with its display time now that it is known,
+// unless it was up for less than 2 centiseconds (viewers stretch such delays to 10), then it is skipped and
+// its time goes to the picture that replaces it.
+void gifFrame(recorder_t *recorder, const record_frame_t *frame)
+{
+    gif_t *gif = recorder->gif;
+    if (gif->has_pending && memcmp(frame->pixels, gif->pending, sizeof gif->pending) == 0)
+    {
+        gif->now += frame->repeat; // a long hold arrives in pieces
+        return;
+    }
+    if (gif->has_pending)
+    {
+        const uint64_t delay = gif->now * 100 / 60 - gif->written;
+        if (delay >= 2)
+        {
+            gifWrite(recorder, gif->pending, (uint32_t)(delay < 0xFFFF ? delay : 0xFFFF));
+            gif->written += delay;
+        }
+    }
+    memcpy(gif->pending, frame->pixels, sizeof gif->pending);
+    gif->has_pending = true;
+    gif->now += frame->repeat;
+}
+
+// Write the last picture and the trailer
+void gifFinish(recorder_t *recorder)
+{
+    gif_t *gif = recorder->gif;
+    if (gif->has_pending)
+    {
+        const uint64_t delay = gif->now * 100 / 60 - gif->written;
+        gifWrite(recorder, gif->pending, (uint32_t)(delay < 2 ? 2 : delay < 0xFFFF ? delay : 0xFFFF));
+    }
+    fputc(0x3B, recorder->file);
+}
+
+// Write published frames, each converted once (and written "repeat" times, except GIFs, which carry the
+// repeat as the frame's delay); sleep while the ring is empty
+void recordWriter(recorder_t *recorder)
+{
+    const size_t plane = RECORD_WIDTH * RECORD_HEIGHT;
+    uint8_t out[6 + 3 * plane]; // Y4M frame header, then the picture
+    uint8_t *const pixels = out + 6;
+    memcpy(out, "FRAME\n", 6);
+    const uint8_t *const start = recorder->format == RECORD_Y4M ? out : pixels;
+    const size_t size = pixels + 3 * plane - start;
+    for (;;)
+    {
+        const bool running = recorder->running.load(std::memory_order_acquire);
+        const uint64_t head = recorder->head.load(std::memory_order_acquire);
+        uint64_t tail = recorder->tail.load(std::memory_order_relaxed);
+        if (head == tail)
+        {
+            if (!running)
+            {
+                if (recorder->format == RECORD_GIF)
+                    gifFinish(recorder);
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        for (; tail != head; tail++)
+        {
+            const record_frame_t *frame = &recorder->ring[tail & (RECORD_RING_SIZE - 1)];
+            if (recorder->format == RECORD_GIF)
+            {
+                gifFrame(recorder, frame);
+                continue;
+            }
+            for (size_t i = 0; i < plane; i++)
+            {
+                const uint8_t *color = (frame->pixels[i / 8] >> (7 - i % 8)) & 1 ? recorder->fg : recorder->bg;
+                if (recorder->format == RECORD_Y4M) // planar
+                {
+                    pixels[i] = color[0];
+                    pixels[plane + i] = color[1];
+                    pixels[2 * plane + i] = color[2];
+                }
+                else // packed
+                    memcpy(&pixels[3 * i], color, 3);
+            }
+            for (uint32_t r = 0; r < frame->repeat; r++)
+                fwrite(start, 1, size, recorder->file);
+        }
+        recorder->tail.store(tail, std::memory_order_release);
+    }
+}
+
+// RGBA8888 color to 8-bit Y, U, V (BT.601, studio range)
+void rgbToYuv(uint32_t rgba, uint8_t yuv[3])
+{
+    const int32_t r = (rgba >> 24) & 0xFF, g = (rgba >> 16) & 0xFF, b = (rgba >> 8) & 0xFF;
+    yuv[0] = (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+    yuv[1] = (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+    yuv[2] = (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+bool startRecord(recorder_t *recorder, const char *path, const config_t config, bool lossless)
+{
+    recorder->file = fopen(path, "wb");
+    if (!recorder->file)
+    {
+        std::cout << "Could not open recording " << path << "\n";
+        return false;
+    }
+    const char *extension = strrchr(path, '.');
+    recorder->format = !extension                      ? RECORD_RAW
+                       : strcmp(extension, ".y4m") == 0 ? RECORD_Y4M
+                       : strcmp(extension, ".gif") == 0 ? RECORD_GIF
+                                                        : RECORD_RAW;
+    recorder->lossless = lossless;
+    if (recorder->format == RECORD_Y4M)
+    {
+        fprintf(recorder->file, "YUV4MPEG2 W%d H%d F60:1 Ip A1:1 C444\n", RECORD_WIDTH, RECORD_HEIGHT);
+        rgbToYuv(config.fg_color, recorder->fg);
+        rgbToYuv(config.bg_color, recorder->bg);
+    }
+    else
+        for (int c = 0; c < 3; c++)
+        {
+            recorder->fg[c] = (config.fg_color >> (24 - 8 * c)) & 0xFF;
+            recorder->bg[c] = (config.bg_color >> (24 - 8 * c)) & 0xFF;
+        }
+    if (recorder->format == RECORD_GIF)
+    {
+        // header, screen descriptor with a 2 color global palette (bg, fg), loop forever
+        const uint8_t header[] = {'G', 'I', 'F', '8', '9', 'a', RECORD_WIDTH, 0, RECORD_HEIGHT, 0, 0x80, 0, 0,
+                                  recorder->bg[0], recorder->bg[1], recorder->bg[2],
+                                  recorder->fg[0], recorder->fg[1], recorder->fg[2],
+                                  0x21, 0xFF, 11, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 3, 1, 0, 0, 0};
+        fwrite(header, 1, sizeof header, recorder->file);
+        recorder->gif = new gif_t();
+    }
+
+    recorder->ring = new record_frame_t[RECORD_RING_SIZE];
+    recorder->head = 0;
+    recorder->tail = 0;
+    recorder->current.repeat = 0;
+    recorder->frames = recorder->unique = recorder->dropped = 0;
+    recorder->running = true;
+    recorder->writer = std::thread(recordWriter, recorder);
+    return true;
+}
+
+// Hand the held back frame to the writer, false if the ring is full
+bool publishRecord(recorder_t *recorder)
+{
+    const uint64_t head = recorder->head.load(std::memory_order_relaxed);
+    if (head - recorder->tail.load(std::memory_order_acquire) == RECORD_RING_SIZE)
+        return false;
+    recorder->ring[head & (RECORD_RING_SIZE - 1)] = recorder->current;
+    recorder->head.store(head + 1, std::memory_order_release);
+    recorder->current.repeat = 0;
+    return true;
+}
+
+// Capture the display as the next 60Hz frame
+void recordFrame(recorder_t *recorder, const chip8_t *chip8)
+{
+    if (!recorder->file)
+        return;
+    record_frame_t frame;
+    packDisplay(chip8, frame.pixels);
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (uint32_t i = 0; i < sizeof frame.pixels; i++)
+        hash = (hash ^ frame.pixels[i]) * 0x100000001B3ull;
+    recorder->frames++;
+
+    if (recorder->current.repeat && hash == recorder->current_hash)
+    {
+        // same picture, shown for one more frame; long holds are passed on so the file keeps up
+        if (++recorder->current.repeat >= RECORD_MAX_REPEAT)
+            publishRecord(recorder);
+        return;
+    }
+    while (recorder->lossless && recorder->current.repeat && !publishRecord(recorder))
+        std::this_thread::yield();
+    if (recorder->current.repeat && !publishRecord(recorder))
+    {
+        recorder->dropped++;
+        recorder->current.repeat++; // the writer is behind, keep showing the previous frame
+        return;
+    }
+    if (hash != recorder->current_hash)
+        recorder->unique++;
+    memcpy(recorder->current.pixels, frame.pixels, sizeof frame.pixels);
+    recorder->current.repeat = 1;
+    recorder->current_hash = hash;
+}
+
+// Write the last frame, wait for the writer and close the file
+void stopRecord(recorder_t *recorder)
+{
+    if (!recorder->file)
+        return;
+    while (recorder->current.repeat && !publishRecord(recorder))
+        std::this_thread::yield();
+    recorder->running.store(false, std::memory_order_release);
+    recorder->writer.join();
+    fclose(recorder->file);
+    delete[] recorder->ring;
+    delete recorder->gif;
+    recorder->file = NULL;
+    recorder->ring = NULL;
+    recorder->gif = NULL;
+    printf("Recorded %llu frames (%llu distinct, %llu dropped)\n", (unsigned long long)recorder->frames,
+           (unsigned long long)recorder->unique, (unsigned long long)recorder->dropped);
+}
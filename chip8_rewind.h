@@ -0,0 +1,214 @@
+#pragma once
+#include <stdio.h>
+#include <cstdlib>
+#include <cstring>
+
+#include "chip8_state.h"
+
+// Rewind buffer: one save state per frame under a fixed memory budget. Every frame is stored as the XOR of
+// its state with the previous frame's, run length encoded (unchanged bytes XOR to zero runs). Every
+// "key_interval" frames the full state is stored as well, so long rewinds restart from a keyframe
+// instead of undoing every frame. The newest state is kept decoded; stepping back one frame is XORing
+// the newest delta into it.
+typedef struct
+{
+    size_t offset;      // record position in data
+    uint32_t delta_size; // encoded XOR with the previous frame
+    uint32_t key_size;   // encoded full state following the delta, 0 if not a keyframe
+} rewind_entry_t;
+
+typedef struct
+{
+    uint8_t *data; // record ring
+    size_t capacity;
+    size_t write; // next record position
+
+    rewind_entry_t *entries; // entry ring, oldest at "first"
+    uint32_t max_entries;
+    uint32_t first;
+    uint32_t count;
+    uint32_t key_interval;
+    uint32_t frames; // frames pushed, for keyframe spacing
+
+    uint8_t head[STATE_SIZE];            // newest state
+    uint8_t scratch[2 * STATE_SIZE + 16]; // encode buffer, worst case of the RLE
+} rewind_t;
+
+// Unsigned LEB128
+uint8_t *putVarint(uint8_t *out, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        *out++ = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    *out++ = value;
+    return out;
+}
+
+const uint8_t *getVarint(const uint8_t *in, uint32_t *value)
+{
+    *value = 0;
+    for (uint8_t shift = 0;; shift += 7)
+    {
+        *value |= (uint32_t)(*in & 0x7F) << shift;
+        if (!(*in++ & 0x80))
+            return in;
+    }
+}
+
+// Encode a ^ b (b NULL = a alone) as (zero run, literal run, literal bytes) tokens
+uint32_t encodeDelta(const uint8_t *a, const uint8_t *b, uint32_t size, uint8_t *out)
+{
+    uint8_t *start = out;
+    uint32_t i = 0;
+    while (i < size)
+    {
+        uint32_t zeros = i;
+        while (zeros < size && (a[zeros] ^ (b ? b[zeros] : 0)) == 0)
+            zeros++;
+        uint32_t literal = zeros;
+        while (literal < size && (a[literal] ^ (b ? b[literal] : 0)) != 0)
+            literal++;
+
+        out = putVarint(out, zeros - i);
+        out = putVarint(out, literal - zeros);
+        for (uint32_t j = zeros; j < literal; j++)
+            *out++ = a[j] ^ (b ? b[j] : 0);
+        i = literal;
+    }
+    return out - start;
+}
+
+// XOR an encoded delta into "state", zero runs are skipped without touching memory
+void applyDelta(uint8_t *state, const uint8_t *in, uint32_t encoded_size)
+{
+    const uint8_t *end = in + encoded_size;
+    uint32_t pos = 0;
+    while (in < end)
+    {
+        uint32_t zeros, literal;
+        in = getVarint(in, &zeros);
+        in = getVarint(in, &literal);
+        pos += zeros;
+        for (uint32_t j = 0; j < literal; j++)
+            state[pos++] ^= *in++;
+    }
+}
+
+// "budget" bytes of encoded frames, at most "max_frames" frames kept, full state every "key_interval" frames
+bool initRewind(rewind_t *rewind, size_t budget, uint32_t max_frames, uint32_t key_interval)
+{
+    memset(rewind, 0, sizeof *rewind);
+    rewind->capacity = budget;
+    rewind->data = (uint8_t *)malloc(budget);
+    rewind->max_entries = max_frames ? max_frames : 1;
+    rewind->entries = (rewind_entry_t *)malloc(rewind->max_entries * sizeof *rewind->entries);
+    rewind->key_interval = key_interval ? key_interval : 60;
+    return rewind->data && rewind->entries;
+}
+
+void freeRewind(rewind_t *rewind)
+{
+    free(rewind->data);
+    free(rewind->entries);
+    rewind->data = NULL;
+    rewind->entries = NULL;
+}
+
+rewind_entry_t *rewindEntry(rewind_t *rewind, uint32_t i)
+{
+    return &rewind->entries[(rewind->first + i) % rewind->max_entries];
+}
+
+// Drop the oldest frame
+void dropOldest(rewind_t *rewind)
+{
+    rewind->first = (rewind->first + 1) % rewind->max_entries;
+    rewind->count--;
+}
+
+// Does [start, start + size) overlap the oldest record?
+bool overlapsOldest(rewind_t *rewind, size_t start, size_t size)
+{
+    if (!rewind->count)
+        return false;
+    const rewind_entry_t *oldest = rewindEntry(rewind, 0);
+    const size_t oldest_end = oldest->offset + oldest->delta_size + oldest->key_size;
+    return start < oldest_end && oldest->offset < start + size;
+}
+
+// Record this frame's state
+void pushRewind(rewind_t *rewind, const chip8_t *chip8)
+{
+    uint8_t state[STATE_SIZE];
+    saveState(chip8, state, sizeof state);
+
+    // Delta against the previous frame (first frame: against nothing), plus the full state on keyframes
+    const bool key = rewind->frames++ % rewind->key_interval == 0;
+    const uint32_t delta_size = encodeDelta(state, rewind->count ? rewind->head : NULL, STATE_SIZE, rewind->scratch);
+    const uint32_t key_size = key ? encodeDelta(state, NULL, STATE_SIZE, rewind->scratch + delta_size) : 0;
+    const size_t size = delta_size + key_size;
+    if (size > rewind->capacity)
+        return; // dropped: "head" stays the newest stored frame, the next delta is against it
+
+    // Make room: wrap to the start if the record doesn't fit before the end, evict what it overwrites
+    size_t start = rewind->write;
+    if (start + size > rewind->capacity)
+    {
+        // Records between the write position and the end are the oldest, they go before the ones at the start
+        while (rewind->count && rewindEntry(rewind, 0)->offset >= rewind->write)
+            dropOldest(rewind);
+        start = 0;
+    }
+    while (overlapsOldest(rewind, start, size) || rewind->count == rewind->max_entries)
+        dropOldest(rewind);
+
+    memcpy(&rewind->data[start], rewind->scratch, size);
+    rewind->write = start + size;
+    *rewindEntry(rewind, rewind->count++) = (rewind_entry_t){.offset = start, .delta_size = delta_size, .key_size = key_size};
+    memcpy(rewind->head, state, sizeof state);
+}
+
+// Step "chip8" back up to "frames" frames, returns frames actually rewound
+uint32_t rewindFrames(rewind_t *rewind, chip8_t *chip8, uint32_t frames)
+{
+    if (rewind->count <= 1 || frames == 0)
+        return 0;
+    if (frames > rewind->count - 1)
+        frames = rewind->count - 1;
+    const uint32_t target = rewind->count - 1 - frames; // entry index to restore
+
+    // Start from the oldest keyframe newer than the target if there is one, otherwise from the newest state
+    uint32_t from = rewind->count - 1;
+    for (uint32_t i = target; i < from; i++)
+        if (rewindEntry(rewind, i)->key_size)
+        {
+            const rewind_entry_t *entry = rewindEntry(rewind, i);
+            memset(rewind->head, 0, sizeof rewind->head);
+            applyDelta(rewind->head, &rewind->data[entry->offset + entry->delta_size], entry->key_size);
+            from = i;
+            break;
+        }
+
+    // Undo frames from "from" down to "target": state[i - 1] = state[i] ^ delta[i]
+    for (uint32_t i = from; i > target; i--)
+    {
+        const rewind_entry_t *entry = rewindEntry(rewind, i);
+        applyDelta(rewind->head, &rewind->data[entry->offset], entry->delta_size);
+    }
+
+    rewind->count = target + 1;
+    rewind->write = rewindEntry(rewind, target)->offset + rewindEntry(rewind, target)->delta_size + rewindEntry(rewind, target)->key_size;
+    loadState(chip8, rewind->head, sizeof rewind->head);
+    return frames;
+}
+
+// Bytes held by encoded frames
+size_t rewindUsage(rewind_t *rewind)
+{
+    size_t used = 0;
+    for (uint32_t i = 0; i < rewind->count; i++)
+        used += rewindEntry(rewind, i)->delta_size + rewindEntry(rewind, i)->key_size;
+    return used;
+}
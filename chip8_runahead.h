@@ -0,0 +1,113 @@
+#pragma once
+#include <stdio.h>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+
+#include "chip8_core.h"
+#include "chip8_input.h"
+
+// Run-ahead hides the input lag games build in by polling the keys (EX9E/EXA1, FX0A) once per game loop and
+// drawing on a later frame. After each real frame the machine is snapshotted (a plain chip8_t copy of a few KB),
+// the copy is emulated N more frames with the same keys and its display is shown instead. Restoring is free
+// because the real machine was never touched, so sound, rewind, recording and netplay all follow the real
+// machine. Key presses are timed to their first visible effect on both the real and the shown display, so the
+// report at exit gives the latency actually removed.
+#define RUNAHEAD_MAX 8
+#define RUNAHEAD_LATENCY_LIMIT 60 // frames to wait for a key press to show before dropping it
+
+typedef struct
+{
+    uint32_t frames; // frames run ahead, 0 off
+    chip8_t ahead;   // snapshot emulated ahead, shown in place of the real machine
+
+    // latency measurement
+    uint16_t keys;                   // keys held in the last frame
+    uint8_t real[64 * 32 / 8];       // real display of the last frame, packed
+    uint8_t shown[64 * 32 / 8];      // shown display of the last frame
+    uint8_t real_base[64 * 32 / 8];  // displays before the key press being timed
+    uint8_t shown_base[64 * 32 / 8];
+    uint32_t since;                  // frames since that key press, UINT32_MAX if none
+    uint32_t real_latency;           // frames until the real display changed, UINT32_MAX until it has
+    uint32_t shown_latency;          // frames until the shown display changed
+    uint32_t presses;                // key presses seen on both displays
+    uint64_t real_total;             // their latencies, frames
+    uint64_t shown_total;
+    double ms;                       // time spent running ahead
+    uint64_t runs;
+} runahead_t;
+
+void initRunAhead(runahead_t *runahead, uint32_t frames)
+{
+    runahead->frames = frames > RUNAHEAD_MAX ? RUNAHEAD_MAX : frames;
+    runahead->since = UINT32_MAX;
+}
+
+// Time the latest key press to its first change on each display
+void measureRunAhead(runahead_t *runahead, const chip8_t *chip8)
+{
+    uint8_t real[sizeof runahead->real], shown[sizeof runahead->shown];
+    packDisplay(chip8, real);
+    packDisplay(&runahead->ahead, shown);
+
+    const uint16_t keys = getKeypad(chip8);
+    if (keys & ~runahead->keys) // a new key went down, time it against the displays before it
+    {
+        memcpy(runahead->real_base, runahead->real, sizeof real);
+        memcpy(runahead->shown_base, runahead->shown, sizeof shown);
+        runahead->since = 0;
+        runahead->real_latency = runahead->shown_latency = UINT32_MAX;
+    }
+    runahead->keys = keys;
+    memcpy(runahead->real, real, sizeof real);
+    memcpy(runahead->shown, shown, sizeof shown);
+    if (runahead->since == UINT32_MAX)
+        return;
+
+    if (runahead->real_latency == UINT32_MAX && memcmp(real, runahead->real_base, sizeof real) != 0)
+        runahead->real_latency = runahead->since;
+    if (runahead->shown_latency == UINT32_MAX && memcmp(shown, runahead->shown_base, sizeof shown) != 0)
+        runahead->shown_latency = runahead->since;
+    if (runahead->real_latency != UINT32_MAX && runahead->shown_latency != UINT32_MAX)
+    {
+        runahead->presses++;
+        runahead->real_total += runahead->real_latency;
+        runahead->shown_total += runahead->shown_latency;
+        runahead->since = UINT32_MAX;
+    }
+    else if (++runahead->since > RUNAHEAD_LATENCY_LIMIT)
+        runahead->since = UINT32_MAX; // no visible effect
+}
+
+// Machine to show for the frame "chip8" just emulated: itself, or a copy run ahead with the same keys
+const chip8_t *runAhead(runahead_t *runahead, const chip8_t *chip8, const config_t config)
+{
+    if (!runahead->frames)
+        return chip8;
+    const auto start = std::chrono::steady_clock::now();
+    runahead->ahead = *chip8;
+#ifdef DEBUG
+    runahead->ahead.tracer = NULL;
+#endif
+#ifdef PROFILE
+    runahead->ahead.profile = NULL;
+#endif
+    for (uint32_t i = 0; i < runahead->frames; i++)
+        emulateFrame(&runahead->ahead, config, NULL);
+    runahead->ms += elapsedMs(start);
+    runahead->runs++;
+
+    measureRunAhead(runahead, chip8);
+    return &runahead->ahead;
+}
+
+void reportRunAhead(const runahead_t *runahead)
+{
+    if (!runahead->frames || !runahead->runs)
+        return;
+    printf("Run-ahead %u: %.1f us per frame", runahead->frames, 1000 * runahead->ms / runahead->runs);
+    if (runahead->presses)
+        printf(", %u key presses shown after %.2f frames on average instead of %.2f", runahead->presses,
+               (double)runahead->shown_total / runahead->presses, (double)runahead->real_total / runahead->presses);
+    printf("\n");
+}
@@ -0,0 +1,192 @@
+#pragma once
+#include <stdio.h>
+#include <cstring>
+#include <iostream>
+
+#include "chip8.h"
+#include "chip8_map.h"
+
+// Save state format, all multi-byte values little endian:
+//   "C8ST" magic, u16 version, u16 size of the whole state
+//   u16 PC, u16 I, V0-VF, delay timer, sound timer, u8 stack pointer, 16 x u16 stack,
+//   u16 keypad bit mask, u8 FX0A awaited key, u8 machine state, u8 draw flag,
+//   16 byte audio pattern, u8 pitch, u32 CXNN random state,
+//   display packed 8 pixels per byte (first pixel in the high bit), 4096 bytes RAM
+#define STATE_VERSION 2
+#define STATE_STACK 16
+#define STATE_SIZE (8 + 4 + 16 + 3 + 2 * STATE_STACK + 2 + 3 + 16 + 1 + 4 + 64 * 32 / 8 + 4096)
+
+void put16(uint8_t **out, uint16_t value)
+{
+    (*out)[0] = value & 0xFF;
+    (*out)[1] = value >> 8;
+    *out += 2;
+}
+
+void put32(uint8_t **out, uint32_t value)
+{
+    put16(out, value & 0xFFFF);
+    put16(out, value >> 16);
+}
+
+uint16_t get16(const uint8_t **in)
+{
+    const uint16_t value = (*in)[0] | ((*in)[1] << 8);
+    *in += 2;
+    return value;
+}
+
+uint32_t get32(const uint8_t **in)
+{
+    const uint32_t low = get16(in);
+    return low | ((uint32_t)get16(in) << 16);
+}
+
+// Serialize machine into "buf", returns bytes written or 0 if "size" is too small
+size_t saveState(const chip8_t *chip8, uint8_t *buf, size_t size)
+{
+    if (size < STATE_SIZE)
+        return 0;
+
+    uint8_t *out = buf;
+    memcpy(out, "C8ST", 4);
+    out += 4;
+    put16(&out, STATE_VERSION);
+    put16(&out, STATE_SIZE);
+
+    put16(&out, chip8->PC);
+    put16(&out, chip8->I);
+    memcpy(out, chip8->V, sizeof chip8->V);
+    out += sizeof chip8->V;
+    *out++ = chip8->delay_timer;
+    *out++ = chip8->sound_timer;
+    *out++ = chip8->sp;
+    for (uint8_t i = 0; i < STATE_STACK; i++)
+        put16(&out, chip8->stack[i]);
+
+    uint16_t keys = 0;
+    for (uint8_t i = 0; i < sizeof chip8->keypad; i++)
+        keys |= chip8->keypad[i] << i;
+    put16(&out, keys);
+    *out++ = chip8->await_key;
+    *out++ = chip8->state;
+    *out++ = chip8->draw;
+    memcpy(out, chip8->pattern, sizeof chip8->pattern);
+    out += sizeof chip8->pattern;
+    *out++ = chip8->pitch;
+    put32(&out, chip8->rng);
+
+    // 8 display bools (0/1 bytes) to one byte: the multiply moves byte i to bit 63 - i
+    for (size_t i = 0; i < sizeof chip8->display; i += 8)
+    {
+        uint64_t pixels;
+        memcpy(&pixels, &chip8->display[i], sizeof pixels);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        pixels = __builtin_bswap64(pixels);
+#endif
+        *out++ = (pixels * 0x8040201008040201ull) >> 56;
+    }
+
+    memcpy(out, chip8->ram, sizeof chip8->ram);
+    out += sizeof chip8->ram;
+    return out - buf;
+}
+
+// Restore machine from "buf", returns false (machine untouched) if it is not a valid state of this version
+bool loadState(chip8_t *chip8, const uint8_t *buf, size_t size)
+{
+    const uint8_t *in = buf;
+    if (size < 8 || memcmp(in, "C8ST", 4) != 0)
+    {
+        std::cout << "Not a CHIP8 save state\n";
+        return false;
+    }
+    in += 4;
+    const uint16_t version = get16(&in);
+    const uint16_t state_size = get16(&in);
+    if (version != STATE_VERSION || state_size != STATE_SIZE || size < STATE_SIZE)
+    {
+        std::cout << "Unsupported save state version " << version << " (" << state_size << " bytes)\n";
+        return false;
+    }
+
+    // machine state byte, after the header, registers, stack, keypad and awaited key
+    const uint8_t machine_state = buf[8 + 4 + 16 + 3 + 2 * STATE_STACK + 2 + 1];
+    if (machine_state > PAUSED)
+    {
+        std::cout << "Invalid machine state " << (int)machine_state << " in save state\n";
+        return false;
+    }
+
+    // pixel bit -> bool byte for every byte value
+    static const struct unpack_t
+    {
+        uint64_t pixels[256];
+        unpack_t()
+        {
+            for (uint32_t b = 0; b < 256; b++)
+            {
+                uint8_t bytes[8];
+                for (uint8_t i = 0; i < 8; i++)
+                    bytes[i] = (b >> (7 - i)) & 1;
+                memcpy(&pixels[b], bytes, sizeof pixels[b]);
+            }
+        }
+    } unpack;
+
+    chip8->PC = get16(&in);
+    chip8->I = get16(&in);
+    memcpy(chip8->V, in, sizeof chip8->V);
+    in += sizeof chip8->V;
+    chip8->delay_timer = *in++;
+    chip8->sound_timer = *in++;
+    chip8->sp = *in++;
+    for (uint8_t i = 0; i < STATE_STACK; i++)
+        chip8->stack[i] = get16(&in);
+
+    const uint16_t keys = get16(&in);
+    for (uint8_t i = 0; i < sizeof chip8->keypad; i++)
+        chip8->keypad[i] = (keys >> i) & 1;
+    chip8->await_key = *in++;
+    chip8->state = (emulator_state_t)*in++; // checked above
+    chip8->draw = *in++;
+    memcpy(chip8->pattern, in, sizeof chip8->pattern);
+    in += sizeof chip8->pattern;
+    chip8->pitch = *in++;
+    chip8->rng = get32(&in);
+
+    for (size_t i = 0; i < sizeof chip8->display; i += 8)
+        memcpy(&chip8->display[i], &unpack.pixels[*in++], 8);
+
+    memcpy(chip8->ram, in, sizeof chip8->ram);
+    return true;
+}
+
+bool saveStateFile(const chip8_t *chip8, const char *path)
+{
+    uint8_t buf[STATE_SIZE];
+    const size_t size = saveState(chip8, buf, sizeof buf);
+    FILE *file = fopen(path, "wb");
+    if (!file || fwrite(buf, size, 1, file) != 1)
+    {
+        std::cout << "Could not write save state " << path << "\n";
+        if (file)
+            fclose(file);
+        return false;
+    }
+    fclose(file);
+    return true;
+}
+
+bool loadStateFile(chip8_t *chip8, const char *path)
+{
+    mapped_file_t file;
+    if (!mapFile(&file, path))
+    {
+        std::cout << "Save state " << path << " invalid or does not exist!\n";
+        return false;
+    }
+    const bool ok = loadState(chip8, file.data, file.size);
+    unmapFile(&file);
+    return ok;
+}
@@ -0,0 +1,338 @@
+#pragma once
+#include <stdio.h>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET socket_t;
+#define closeSocket closesocket
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+typedef int socket_t;
+#define INVALID_SOCKET -1
+#define closeSocket close
+#endif
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#include "chip8_core.h"
+#include "chip8_state.h" // put32
+
+// Display streaming server on a local TCP port or Unix socket, for viewers that watch (and play) a running
+// emulator. Every message is a u8 type, a u16 payload length and the payload, little endian:
+//   server -> viewer 'K' keyframe: u32 frame, 256 byte packed display (packDisplay: 32 rows of 8 bytes)
+//                    'D' delta:    u32 frame, u32 row mask (bit N = row N), 8 bytes per set row, XOR with the
+//                                  previous frame; frames without changes send nothing
+//   viewer -> server 'I' input:    u16 keypad mask (bit N = key N down), held until the next 'I'
+// Each frame is encoded once and the bytes queued for every viewer. Sockets never block: a viewer that falls
+// STREAM_BACKLOG bytes behind stops getting deltas, and once it has drained what it has gets a fresh keyframe.
+#define STREAM_MAX_VIEWERS 16
+#define STREAM_BACKLOG (64 * 1024)
+
+typedef struct
+{
+    socket_t socket;
+    uint8_t out[STREAM_BACKLOG]; // queued bytes, out[sent..size) not sent yet
+    size_t size;
+    size_t sent;
+    bool resync;    // needs a keyframe before more deltas
+    uint8_t in[64]; // partial input message
+    size_t in_size;
+    uint16_t keys;  // keypad mask last sent by this viewer
+    bool input;     // has sent keypad input
+} viewer_t;
+
+typedef struct
+{
+    bool serving; // listening, false for a zeroed stream_t
+    socket_t listener;
+    const char *path; // Unix socket path, NULL for TCP
+    viewer_t viewers[STREAM_MAX_VIEWERS];
+    uint8_t frame[64 * 32 / 8]; // last frame sent, packed
+    uint32_t frame_count;
+    uint16_t keys; // keys the viewers held last frame, released once no viewer sends input
+} stream_t;
+
+bool setNonBlocking(socket_t socket)
+{
+#if defined(_WIN32)
+    u_long on = 1;
+    return ioctlsocket(socket, FIONBIO, &on) == 0;
+#else
+    return fcntl(socket, F_SETFL, fcntl(socket, F_GETFL) | O_NONBLOCK) == 0;
+#endif
+}
+
+// Listen on "address": a port number for TCP on 127.0.0.1, anything else is a Unix socket path
+bool startStream(stream_t *stream, const char *address)
+{
+    memset(stream, 0, sizeof *stream);
+    stream->listener = INVALID_SOCKET;
+    for (viewer_t &viewer : stream->viewers)
+        viewer.socket = INVALID_SOCKET;
+#if defined(_WIN32)
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0)
+    {
+        std::cout << "Could not start Winsock\n";
+        return false;
+    }
+#endif
+
+    const bool tcp = address[0] && strspn(address, "0123456789") == strlen(address);
+    int result = -1;
+    if (tcp)
+    {
+        stream->listener = socket(AF_INET, SOCK_STREAM, 0);
+        const int on = 1;
+        setsockopt(stream->listener, SOL_SOCKET, SO_REUSEADDR, (const char *)&on, sizeof on);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)strtol(address, NULL, 10));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (stream->listener != INVALID_SOCKET)
+            result = bind(stream->listener, (const sockaddr *)&addr, sizeof addr);
+    }
+    else
+    {
+#if defined(_WIN32)
+        std::cout << "Unix socket streaming is not supported on Windows, give a port number\n";
+        return false;
+#else
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        if (strlen(address) >= sizeof addr.sun_path)
+        {
+            std::cout << "Stream socket path " << address << " too long\n";
+            return false;
+        }
+        strcpy(addr.sun_path, address);
+        unlink(address); // left over from an earlier run
+        stream->path = address;
+        stream->listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (stream->listener != INVALID_SOCKET)
+            result = bind(stream->listener, (const sockaddr *)&addr, sizeof addr);
+#endif
+    }
+    if (result != 0 || listen(stream->listener, STREAM_MAX_VIEWERS) != 0 || !setNonBlocking(stream->listener))
+    {
+        std::cout << "Could not listen for stream viewers on " << address << "\n";
+        if (stream->listener != INVALID_SOCKET)
+            closeSocket(stream->listener);
+        stream->listener = INVALID_SOCKET;
+        return false;
+    }
+    std::cout << "Streaming display on " << (tcp ? "127.0.0.1:" : "") << address << "\n";
+    stream->serving = true;
+    return true;
+}
+
+void dropViewer(viewer_t *viewer)
+{
+    closeSocket(viewer->socket);
+    viewer->socket = INVALID_SOCKET;
+}
+
+// Queue a message for a viewer, false if its backlog is full
+bool queueMessage(viewer_t *viewer, const uint8_t *message, size_t size)
+{
+    if (viewer->sent == viewer->size)
+        viewer->sent = viewer->size = 0;
+    if (size > sizeof viewer->out - viewer->size)
+    {
+        // make room by moving the unsent bytes to the front
+        memmove(viewer->out, viewer->out + viewer->sent, viewer->size - viewer->sent);
+        viewer->size -= viewer->sent;
+        viewer->sent = 0;
+        if (size > sizeof viewer->out - viewer->size)
+            return false;
+    }
+    memcpy(viewer->out + viewer->size, message, size);
+    viewer->size += size;
+    return true;
+}
+
+// Send what the socket takes without waiting, false if the viewer disconnected
+bool flushViewer(viewer_t *viewer)
+{
+    while (viewer->sent < viewer->size)
+    {
+        const int sent = send(viewer->socket, (const char *)viewer->out + viewer->sent, (int)(viewer->size - viewer->sent), MSG_NOSIGNAL);
+        if (sent > 0)
+        {
+            viewer->sent += sent;
+            continue;
+        }
+#if defined(_WIN32)
+        return sent < 0 && WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+        return sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+#endif
+    }
+    return true;
+}
+
+// Read keypad messages, false if the viewer disconnected
+bool readViewer(viewer_t *viewer)
+{
+    for (;;)
+    {
+        const int got = recv(viewer->socket, (char *)viewer->in + viewer->in_size, (int)(sizeof viewer->in - viewer->in_size), 0);
+        if (got == 0)
+            return false;
+        if (got < 0)
+#if defined(_WIN32)
+            return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+        viewer->in_size += got;
+
+        size_t at = 0;
+        while (viewer->in_size - at >= 3)
+        {
+            const uint8_t *message = viewer->in + at;
+            const size_t length = message[1] | message[2] << 8;
+            if (length > sizeof viewer->in - 3)
+                return false; // nothing a viewer sends is that long
+            if (viewer->in_size - at < 3 + length)
+                break;
+            if (message[0] == 'I' && length == 2)
+            {
+                viewer->keys = message[3] | message[4] << 8;
+                viewer->input = true;
+            }
+            at += 3 + length;
+        }
+        memmove(viewer->in, viewer->in + at, viewer->in_size - at);
+        viewer->in_size -= at;
+    }
+}
+
+// Stream the current display to every viewer and take their keypad input; call once per frame
+void serveFrame(stream_t *stream, chip8_t *chip8)
+{
+    if (!stream->serving)
+        return;
+
+    // new viewers start with a keyframe
+    for (;;)
+    {
+        const socket_t socket = accept(stream->listener, NULL, NULL);
+        if (socket == INVALID_SOCKET)
+            break;
+        viewer_t *viewer = NULL;
+        for (viewer_t &slot : stream->viewers)
+            if (slot.socket == INVALID_SOCKET)
+            {
+                viewer = &slot;
+                break;
+            }
+        if (!viewer || !setNonBlocking(socket))
+        {
+            closeSocket(socket);
+            continue;
+        }
+        const int on = 1;
+        setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char *)&on, sizeof on); // fails harmlessly on Unix sockets
+#ifdef SO_NOSIGPIPE
+        setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, (const char *)&on, sizeof on); // no MSG_NOSIGNAL on macOS
+#endif
+        memset(viewer, 0, sizeof *viewer);
+        viewer->socket = socket;
+        viewer->resync = true;
+    }
+
+    // keypad: every connected viewer's keys together, left alone unless one of them sends input
+    uint16_t keys = 0;
+    bool input = false;
+    for (viewer_t &viewer : stream->viewers)
+        if (viewer.socket != INVALID_SOCKET)
+        {
+            if (!readViewer(&viewer))
+            {
+                dropViewer(&viewer);
+                continue;
+            }
+            keys |= viewer.keys;
+            input |= viewer.input;
+        }
+    for (uint8_t key = 0; key < 16; key++)
+        if (input)
+            chip8->keypad[key] = (keys >> key) & 1;
+        else if ((stream->keys >> key) & 1)
+            chip8->keypad[key] = false;
+    stream->keys = input ? keys : 0;
+
+    // encode once: a keyframe of the new frame and the rows that changed since the last one
+    uint8_t packed[sizeof stream->frame];
+    packDisplay(chip8, packed);
+    const uint32_t frame = ++stream->frame_count;
+    uint8_t keyframe[3 + 4 + sizeof packed] = {'K', (uint8_t)(sizeof keyframe - 3), (uint8_t)((sizeof keyframe - 3) >> 8)};
+    uint8_t *out = keyframe + 3;
+    put32(&out, frame);
+    memcpy(out, packed, sizeof packed);
+
+    uint8_t delta[3 + 4 + 4 + sizeof packed] = {'D'};
+    uint32_t rows = 0;
+    size_t size = 11;
+    for (uint32_t row = 0; row < 32; row++)
+    {
+        uint8_t changed = 0;
+        for (uint32_t i = 0; i < 8; i++)
+            changed |= delta[size + i] = packed[row * 8 + i] ^ stream->frame[row * 8 + i];
+        if (changed)
+        {
+            rows |= 1u << row;
+            size += 8;
+        }
+    }
+    delta[1] = (uint8_t)(size - 3);
+    delta[2] = (uint8_t)((size - 3) >> 8);
+    out = delta + 3;
+    put32(&out, frame);
+    put32(&out, rows);
+    memcpy(stream->frame, packed, sizeof packed);
+
+    for (viewer_t &viewer : stream->viewers)
+    {
+        if (viewer.socket == INVALID_SOCKET)
+            continue;
+        // a viewer that fell behind gets nothing new until it has caught up, then starts over from a keyframe
+        if (viewer.resync && viewer.sent == viewer.size)
+            viewer.resync = !queueMessage(&viewer, keyframe, sizeof keyframe);
+        else if (!viewer.resync && rows)
+            viewer.resync = !queueMessage(&viewer, delta, size);
+        if (!flushViewer(&viewer))
+            dropViewer(&viewer);
+    }
+}
+
+void stopStream(stream_t *stream)
+{
+    if (!stream->serving)
+        return;
+    for (viewer_t &viewer : stream->viewers)
+        if (viewer.socket != INVALID_SOCKET)
+            dropViewer(&viewer);
+    closeSocket(stream->listener);
+    stream->listener = INVALID_SOCKET;
+    stream->serving = false;
+#if defined(_WIN32)
+    WSACleanup();
+#else
+    if (stream->path)
+        unlink(stream->path);
+#endif
+}
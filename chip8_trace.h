@@ -0,0 +1,147 @@
+#pragma once
+#include <stdio.h>
+#include <cstring>
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+#include "chip8.h"
+
+// Binary instruction trace (DEBUG builds). emulateInstruction fills one fixed size record per instruction
+// straight into a single producer/single consumer ring, a writer thread streams the ring to disk. The
+// record holds every operand print_debug_info shows, "chip8-trace" decodes a trace back into that text.
+//
+// File: "C8TR" magic, u16 version, u16 record size, then records in host byte order (little endian on every
+// supported target).
+#define TRACE_VERSION 1
+#define TRACE_RING_SIZE (1 << 16) // records, power of two
+
+typedef struct
+{
+    uint64_t cycle;   // instructions executed before this one
+    uint16_t pc;      // instruction address
+    uint16_t opcode;
+    uint16_t I;       // before the instruction
+    uint16_t ret;     // top of stack before the instruction (00EE target)
+    uint16_t changed; // V registers written, bit N = VN
+    uint8_t vx;       // VX, VY, V0 before the instruction
+    uint8_t vy;
+    uint8_t v0;
+    uint8_t delay;    // delay timer before the instruction
+    uint8_t key;      // keypad[VX]
+    uint8_t result;   // VX after the instruction
+    uint8_t flag;     // VF after the instruction
+    uint8_t padding[5];
+} trace_record_t;
+
+struct tracer_t
+{
+    FILE *file;
+    trace_record_t *ring; // TRACE_RING_SIZE records
+    std::atomic<uint64_t> head; // records published by the emulator
+    std::atomic<uint64_t> tail; // records written by the writer thread
+    std::atomic<bool> running;
+    std::thread writer;
+    uint64_t cycle;
+    uint8_t V[16]; // V before the current instruction
+};
+
+// Writer thread: write published records in contiguous runs, sleep while the ring is empty
+void traceWriter(tracer_t *tracer)
+{
+    for (;;)
+    {
+        const bool running = tracer->running.load(std::memory_order_acquire);
+        const uint64_t head = tracer->head.load(std::memory_order_acquire);
+        uint64_t tail = tracer->tail.load(std::memory_order_relaxed);
+        if (head == tail)
+        {
+            if (!running)
+                return;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        while (tail != head)
+        {
+            const uint64_t index = tail & (TRACE_RING_SIZE - 1);
+            const uint64_t count = head - tail < TRACE_RING_SIZE - index ? head - tail : TRACE_RING_SIZE - index;
+            fwrite(&tracer->ring[index], sizeof *tracer->ring, count, tracer->file);
+            tail += count;
+        }
+        tracer->tail.store(tail, std::memory_order_release);
+    }
+}
+
+bool startTrace(tracer_t *tracer, const char *path)
+{
+    tracer->file = fopen(path, "wb");
+    if (!tracer->file)
+    {
+        std::cout << "Could not open trace " << path << "\n";
+        return false;
+    }
+    const uint8_t header[8] = {'C', '8', 'T', 'R', TRACE_VERSION, 0, sizeof(trace_record_t), 0};
+    fwrite(header, sizeof header, 1, tracer->file);
+
+    tracer->ring = new trace_record_t[TRACE_RING_SIZE];
+    tracer->head = 0;
+    tracer->tail = 0;
+    tracer->cycle = 0;
+    tracer->running = true;
+    tracer->writer = std::thread(traceWriter, tracer);
+    return true;
+}
+
+// Flush remaining records and close the file
+void stopTrace(tracer_t *tracer)
+{
+    if (!tracer->file)
+        return;
+    tracer->running.store(false, std::memory_order_release);
+    tracer->writer.join();
+    fclose(tracer->file);
+    delete[] tracer->ring;
+    tracer->file = NULL;
+    tracer->ring = NULL;
+}
+
+// Claim the next record and fill in the state before the (already fetched and decoded) instruction.
+// Waits for the writer if the ring is full, a trace never drops records.
+trace_record_t *traceBegin(tracer_t *tracer, const chip8_t *chip8)
+{
+    const uint64_t head = tracer->head.load(std::memory_order_relaxed);
+    while (head - tracer->tail.load(std::memory_order_acquire) == TRACE_RING_SIZE)
+        std::this_thread::yield();
+
+    trace_record_t *record = &tracer->ring[head & (TRACE_RING_SIZE - 1)];
+    memcpy(tracer->V, chip8->V, sizeof tracer->V);
+    const uint8_t vx = chip8->V[chip8->inst.X];
+    *record = (trace_record_t){
+        .cycle = tracer->cycle++,
+        .pc = (uint16_t)(chip8->PC - 2),
+        .opcode = chip8->inst.opcode,
+        .I = chip8->I,
+        .ret = chip8->stack[(chip8->sp - 1) & 0xF],
+        .changed = 0,
+        .vx = vx,
+        .vy = chip8->V[chip8->inst.Y],
+        .v0 = chip8->V[0],
+        .delay = chip8->delay_timer,
+        .key = chip8->keypad[vx & 0xF],
+        .result = 0,
+        .flag = 0,
+        .padding = {0},
+    };
+    return record;
+}
+
+// Record what the instruction changed and publish the record
+void traceEnd(tracer_t *tracer, trace_record_t *record, const chip8_t *chip8)
+{
+    for (uint8_t i = 0; i < 16; i++)
+        record->changed |= (chip8->V[i] != tracer->V[i]) << i;
+    record->result = chip8->V[record->opcode >> 8 & 0xF];
+    record->flag = chip8->V[0xF];
+    tracer->head.store(tracer->head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <iostream>
+
+#include "chip8_lanes.h"
+
+// Lockstep differential test: the same ROM runs on CHIP8_LANES scalar machines (emulateInstruction) and on the
+// lane engine, one instruction at a time. After every instruction each scalar machine's state is compared
+// against its lane; the first mismatch is reported with the instruction that caused it and a state diff.
+
+// Same machine state? hashChip8 plus the audio and FX0A fields it leaves out
+bool sameChip8(const chip8_t *a, const chip8_t *b)
+{
+    return hashChip8(a) == hashChip8(b) && a->await_key == b->await_key && a->pitch == b->pitch &&
+           memcmp(a->pattern, b->pattern, sizeof a->pattern) == 0;
+}
+
+// Print every field that differs between the scalar ("a") and lane ("b") machine
+void printDiff(const chip8_t *a, const chip8_t *b)
+{
+    const auto field = [](const char *name, uint32_t x, uint32_t y)
+    {
+        if (x != y)
+            printf("  %-12s scalar 0x%X  lanes 0x%X\n", name, x, y);
+    };
+    field("PC", a->PC, b->PC);
+    field("I", a->I, b->I);
+    for (uint8_t x = 0; x < 16; x++)
+    {
+        char name[8];
+        snprintf(name, sizeof name, "V%X", x);
+        field(name, a->V[x], b->V[x]);
+    }
+    field("delay_timer", a->delay_timer, b->delay_timer);
+    field("sound_timer", a->sound_timer, b->sound_timer);
+    field("sp", a->sp, b->sp);
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        char name[16];
+        snprintf(name, sizeof name, "stack[%u]", i);
+        field(name, a->stack[i], b->stack[i]);
+    }
+    field("rng", a->rng, b->rng);
+    field("await_key", a->await_key, b->await_key);
+    field("pitch", a->pitch, b->pitch);
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        char name[16];
+        snprintf(name, sizeof name, "pattern[%u]", i);
+        field(name, a->pattern[i], b->pattern[i]);
+    }
+
+    // Memory and display can differ in many places, show the first few
+    uint32_t total = 0;
+    for (uint16_t addr = 0; addr < sizeof a->ram; addr++)
+        if (a->ram[addr] != b->ram[addr] && total++ < 8)
+            printf("  ram[0x%03X]   scalar 0x%02X  lanes 0x%02X\n", addr, a->ram[addr], b->ram[addr]);
+    if (total > 8)
+        printf("  ... %u more RAM bytes\n", total - 8);
+    total = 0;
+    for (uint16_t i = 0; i < sizeof a->display; i++)
+        if (a->display[i] != b->display[i] && total++ < 8)
+            printf("  pixel %2u,%2u  scalar %u  lanes %u\n", i % 64, i / 64, a->display[i], b->display[i]);
+    if (total > 8)
+        printf("  ... %u more pixels\n", total - 8);
+}
+
+int main(int argv, char **args)
+{
+    if (argv < 2)
+    {
+        std::cerr << "Usage " << args[0] << " <rom_name> [--frames N] [--ips N] [--seed N]\n";
+        return 1;
+    }
+
+    config_t config = {0};
+    setupEmulator(&config, argv, args);
+    const uint32_t frames = config.frames ? config.frames : 600;
+    const uint32_t insts = config.insts_per_second / 60 ? config.insts_per_second / 60 : 1;
+
+    static chip8_t chip8[CHIP8_LANES];
+    for (uint8_t l = 0; l < CHIP8_LANES; l++)
+    {
+        if (!initChip8(&chip8[l], args[1]))
+            return 1;
+        seedChip8(&chip8[l], config.seed + l); // Different CXNN sequence per lane, so lanes take different paths
+    }
+    chip8_lanes_t *lanes = new chip8_lanes_t;
+    initLanes(lanes, &chip8[0]);
+    for (uint8_t l = 0; l < CHIP8_LANES; l++)
+        setLane(lanes, l, &chip8[l]);
+
+    static chip8_t lane;
+    uint64_t step = 0;
+    for (uint32_t f = 0; f < frames; f++)
+    {
+        for (uint32_t i = 0; i < insts; i++, step++)
+        {
+            uint16_t pc[CHIP8_LANES], opcode[CHIP8_LANES];
+            for (uint8_t l = 0; l < CHIP8_LANES; l++)
+            {
+                pc[l] = chip8[l].PC;
+                opcode[l] = (chip8[l].ram[pc[l] & 0xFFF] << 8) | chip8[l].ram[(pc[l] + 1) & 0xFFF];
+                emulateInstruction(&chip8[l], config);
+            }
+            stepLanes(lanes, config);
+
+            for (uint8_t l = 0; l < CHIP8_LANES; l++)
+            {
+                getLane(lanes, l, &lane);
+                if (sameChip8(&chip8[l], &lane))
+                    continue;
+                char text[32];
+                formatOpcode(opcode[l], text, sizeof text);
+                printf("Divergence at step %llu (frame %u), lane %u\n", (unsigned long long)step, f, l);
+                printf("0x%03X: 0x%04X  %s  (%s)\n", pc[l], opcode[l], text, opcode_info[opcodeClass(opcode[l])].description);
+                printDiff(&chip8[l], &lane);
+                delete lanes;
+                return 1;
+            }
+        }
+        for (uint8_t l = 0; l < CHIP8_LANES; l++)
+            updateTimers(&chip8[l]);
+        updateLanesTimers(lanes);
+    }
+
+    printf("%s: %u lanes agree for %llu instructions\n", args[1], CHIP8_LANES, (unsigned long long)step);
+    delete lanes;
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include <stdio.h>
+#include <iostream>
+
+#include "chip8_disasm.h"
+
+// Disassemble a ROM: listing on stdout, optional control flow and call graphs as Graphviz DOT
+int main(int argv, char **args)
+{
+    if (argv < 2)
+    {
+        std::cerr << "Usage " << args[0] << " <rom_name> [--cfg cfg.dot] [--calls calls.dot]\n";
+        return 1;
+    }
+    const char *cfg_path = NULL;
+    const char *calls_path = NULL;
+    for (int i = 2; i < argv; i++)
+    {
+        if (strncmp(args[i], "--cfg", strlen("--cfg")) == 0)
+        {
+            i++;
+            cfg_path = args[i];
+        }
+        if (strncmp(args[i], "--calls", strlen("--calls")) == 0)
+        {
+            i++;
+            calls_path = args[i];
+        }
+    }
+
+    FILE *rom = fopen(args[1], "rb");
+    if (!rom)
+    {
+        std::cout << "ROM " << args[1] << " invalid or does not exist!\n";
+        return 1;
+    }
+    static uint8_t image[4096 - DISASM_ENTRY + 1];
+    const size_t size = fread(image, 1, sizeof image, rom);
+    fclose(rom);
+
+    static disasm_t disasm;
+    if (!disassemble(&disasm, image, size))
+    {
+        std::cout << "ROM " << args[1] << " too big(" << size << ")\n";
+        return 1;
+    }
+    printListing(&disasm, stdout);
+
+    const struct
+    {
+        const char *path;
+        void (*print)(const disasm_t *, FILE *);
+    } graphs[] = {{cfg_path, printCfgDot}, {calls_path, printCallDot}};
+    for (const auto &graph : graphs)
+    {
+        if (!graph.path)
+            continue;
+        FILE *out = fopen(graph.path, "w");
+        if (!out)
+        {
+            std::cout << "Could not write " << graph.path << "\n";
+            return 1;
+        }
+        graph.print(&disasm, out);
+        fclose(out);
+    }
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <csignal>
+
+#include "chip8_core.h"
+
+// Fuzz target for the instruction core, built with ASan/UBSan so out of bounds accesses crash
+// (UBSan's bounds check covers the arrays inside chip8_t). Input layout:
+//   u8 K, K x u16 keypad masks (big endian, bit N = key N down, one per frame, repeating), ROM image
+// The ROM is booted with loadChip8 and run for FUZZ_FRAMES frames.
+
+#ifndef FUZZ_FRAMES
+#define FUZZ_FRAMES 60
+#endif
+
+// Input being run, for the standalone driver's crash report
+static const uint8_t *fuzz_data;
+static size_t fuzz_size;
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if (size < 1 || size < 1 + 2 * (size_t)data[0])
+        return 0;
+    fuzz_data = data;
+    fuzz_size = size;
+
+    const uint8_t keys = data[0];
+    const uint8_t *masks = data + 1;
+    const uint8_t *rom = masks + 2 * keys;
+    size_t rom_size = data + size - rom;
+    if (rom_size > 4096 - 0x200)
+        rom_size = 4096 - 0x200;
+
+    static chip8_t chip8;
+    loadChip8(&chip8, rom, rom_size, "fuzz");
+    seedChip8(&chip8, size);
+
+    static config_t config;
+    if (!config.window_width)
+        setupEmulator(&config, 0, NULL); // default 64x32 machine at 700 instructions per second
+    const uint32_t insts = config.insts_per_second / 60;
+    for (uint32_t f = 0; f < FUZZ_FRAMES; f++)
+    {
+        const uint16_t mask = keys ? (masks[2 * (f % keys)] << 8) | masks[2 * (f % keys) + 1] : 0;
+        for (uint8_t key = 0; key < 16; key++)
+            chip8.keypad[key] = (mask >> key) & 1;
+        for (uint32_t i = 0; i < insts; i++)
+            emulateInstruction(&chip8, config);
+        updateTimers(&chip8);
+    }
+    return 0;
+}
+
+#ifdef FUZZ_STANDALONE
+// Driver for compilers without libFuzzer: replays the given input files, or runs random inputs
+// (--runs N, --seed N). Sanitizer reports abort, and the input that crashed is written to crash-input.bin.
+extern "C" const char *__asan_default_options() { return "abort_on_error=1"; }
+extern "C" const char *__ubsan_default_options() { return "abort_on_error=1:halt_on_error=1:print_stacktrace=1"; }
+
+void onAbort(int sig)
+{
+    FILE *out = fopen("crash-input.bin", "wb");
+    if (out)
+    {
+        fwrite(fuzz_data, 1, fuzz_size, out);
+        fclose(out);
+        fprintf(stderr, "Input written to crash-input.bin\n");
+    }
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+int main(int argv, char **args)
+{
+    signal(SIGABRT, onAbort);
+    uint64_t runs = 100000;
+    uint32_t rng = 1;
+    std::vector<const char *> files;
+    for (int i = 1; i < argv; i++)
+    {
+        if (strncmp(args[i], "--runs", strlen("--runs")) == 0)
+        {
+            i++;
+            runs = strtoull(args[i], NULL, 10);
+        }
+        else if (strncmp(args[i], "--seed", strlen("--seed")) == 0)
+        {
+            i++;
+            rng = strtoul(args[i], NULL, 0) | 1;
+        }
+        else
+            files.push_back(args[i]);
+    }
+
+    std::vector<uint8_t> input;
+    for (const char *path : files)
+    {
+        FILE *file = fopen(path, "rb");
+        if (!file)
+        {
+            std::cout << "Input " << path << " invalid or does not exist!\n";
+            return 1;
+        }
+        input.resize(1 + 2 * 255 + 4096);
+        input.resize(fread(input.data(), 1, input.size(), file));
+        fclose(file);
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+        printf("%s: ok\n", path);
+    }
+    if (!files.empty())
+        return 0;
+
+    // Random keypad scripts and ROMs of random length
+    const auto next = [&rng]()
+    {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        return rng;
+    };
+    for (uint64_t run = 0; run < runs; run++)
+    {
+        const uint8_t keys = next() % 8;
+        input.resize(1 + 2 * keys + next() % (4096 - 0x200 + 1));
+        input[0] = keys;
+        for (size_t i = 1; i < input.size(); i++)
+            input[i] = next();
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+    }
+    printf("%llu runs ok\n", (unsigned long long)runs);
+    return 0;
+}
+#endif
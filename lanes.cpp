@@ -0,0 +1,50 @@
+#include <stdio.h>
+#include <iostream>
+#include <chrono>
+
+#include "chip8_lanes.h"
+
+// Compare machine-frames per second of the lockstep lane engine against CHIP8_LANES scalar machines
+int main(int argv, char **args)
+{
+    if (argv < 2)
+    {
+        std::cerr << "Usage " << args[0] << " <rom_name> [--frames N] [--ips N]\n";
+        return 1;
+    }
+
+    config_t config = {0};
+    setupEmulator(&config, argv, args);
+    const uint32_t frames = config.frames ? config.frames : 600;
+
+    static chip8_t chip8[CHIP8_LANES];
+    for (uint8_t l = 0; l < CHIP8_LANES; l++)
+    {
+        if (!initChip8(&chip8[l], args[1]))
+            return 1;
+        seedChip8(&chip8[l], config.seed + l); // Different CXNN sequence per machine, so lanes diverge like independent environments
+    }
+
+    chip8_lanes_t *lanes = new chip8_lanes_t;
+    initLanes(lanes, &chip8[0]);
+    for (uint8_t l = 0; l < CHIP8_LANES; l++)
+        setLane(lanes, l, &chip8[l]);
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t f = 0; f < frames; f++)
+        for (uint8_t l = 0; l < CHIP8_LANES; l++)
+            emulateFrame(&chip8[l], config, NULL);
+    const double scalar_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t f = 0; f < frames; f++)
+        emulateLanesFrame(lanes, config);
+    const double lanes_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const double machine_frames = (double)frames * CHIP8_LANES;
+    printf("{\"lanes\":%d,\"frames\":%u,\"scalar_fps\":%.0f,\"lanes_fps\":%.0f,\"speedup\":%.2f}\n",
+           CHIP8_LANES, frames, machine_frames / scalar_s, machine_frames / lanes_s, scalar_s / lanes_s);
+
+    delete lanes;
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include <stdio.h>
+#include <iostream>
+#include <chrono>
+
+#include "chip8_library.h"
+
+// Build or update a ROM library index from ROM directories, then list it or look up one ROM
+int main(int argv, char **args)
+{
+    if (argv < 2)
+    {
+        std::cerr << "Usage " << args[0] << " <index> [rom_dir|rom_name...] [--find rom_name]\n";
+        return 1;
+    }
+    const char *find = NULL;
+    std::vector<std::string> dirs;
+    for (int i = 2; i < argv; i++)
+    {
+        if (strncmp(args[i], "--find", strlen("--find")) == 0)
+        {
+            i++;
+            find = args[i];
+        }
+        else
+            dirs.push_back(args[i]);
+    }
+
+    if (!dirs.empty())
+    {
+        const auto start = std::chrono::steady_clock::now();
+        uint32_t scanned, hashed;
+        if (!buildLibrary(args[1], dirs, &scanned, &hashed))
+            return 1;
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        printf("%u ROMs indexed (%u new or changed) in %.1f ms\n", scanned, hashed, ms);
+    }
+
+    library_t library;
+    if (!openLibrary(&library, args[1]))
+        return 1;
+
+    const auto print = [&library](const library_entry_t *entry)
+    {
+        char quirks[128], sensitive[128];
+        formatQuirks(entry->quirks, quirks, sizeof quirks);
+        formatQuirks(entry->sensitive, sensitive, sizeof sensitive);
+        printf("%016llx  %5u  %-8s  %5u  %-36s  %-36s  %s\n", (unsigned long long)entry->hash, entry->size,
+               platform_names[entry->platform], entry->ips, quirks, sensitive, libraryPath(&library, entry));
+    };
+    printf("%-16s  %5s  %-8s  %5s  %-36s  %-36s  %s\n", "hash", "size", "platform", "ips", "quirks", "uses", "path");
+    if (find)
+    {
+        const library_entry_t *entry = libraryLookup(&library, find);
+        if (!entry)
+        {
+            std::cout << "ROM " << find << " is not in the library\n";
+            closeLibrary(&library);
+            return 1;
+        }
+        print(entry);
+    }
+    else
+        for (uint32_t i = 0; i < library.count; i++)
+            print(&library.entries[i]);
+    closeLibrary(&library);
+    return 0;
+}
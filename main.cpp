@@ -2,9 +2,17 @@
 #include <iostream>
 
 #include "chip8_emulator.h"
+#include "chip8_rewind.h"
+#include "chip8_library.h"
+#include "chip8_record.h"
+#include "chip8_stream.h"
+#include "chip8_input.h"
+#include "chip8_netplay.h"
+#include "chip8_runahead.h"
 
 int main(int argv, char **args)
 {
+    const auto start = std::chrono::steady_clock::now();
     if (argv < 2)
     {
         std::cerr << "Usage " << args[0] << " <rom_name>\n";
@@ -14,22 +22,109 @@ int main(int argv, char **args)
     if (!setupEmulator(&config, argv, args))
         std::cout << "Window can't be rendered: Configuration un-initialized\n";
 
-    // initialize sdl
-    sdl_t sdl = {0};
-    if (!initSDl(&sdl, &config))
-        std::cout << "SDL not Initialized\n";
-
-   
-
     // chip8 init
     chip8_t chip8 = {};
     const char *rom_name = args[1];
+    const auto rom_start = std::chrono::steady_clock::now();
     if (!initChip8(&chip8, rom_name))
         std::cout << "CHIP8 not initialized\n";
+    const double rom_ms = elapsedMs(rom_start);
+    if (config.library_path)
+        applyLibrary(&config, config.library_path, rom_name);
+    seedChip8(&chip8, config.seed);
+#ifdef DEBUG
+    // instruction trace, "chip8-trace" turns it into text
+    static tracer_t tracer;
+    if (startTrace(&tracer, config.trace_path))
+        chip8.tracer = &tracer;
+#endif
+#ifdef PROFILE
+    // execution profile, reported at exit
+    static profile_t profile;
+    initProfile(&profile);
+    chip8.profile = &profile;
+#endif
+
+    // scripted keypad input, applied at the start of each emulated frame
+    input_script_t script = {};
+    if (config.input_path && !loadInputScript(&script, config.input_path))
+        return 1;
+
+    // two player netplay, waits for the peer to boot the same machine
+    static netplay_t netplay;
+    if (config.netplay_address && !startNetplay(&netplay, config.netplay_address, config.rollback_frames, &chip8, config))
+        return 1;
+
+    // run-ahead, shows a future frame; headless runs only measure it
+    static runahead_t runahead;
+    initRunAhead(&runahead, config.run_ahead);
+
+    // display streaming to local viewers, which can also drive the keypad
+    static stream_t stream;
+    if (config.serve_address && !startStream(&stream, config.serve_address))
+        return 1;
+
+    // video capture, of every emulated frame when headless and of every presented frame otherwise
+    static recorder_t recorder;
+    if (config.record_path && !startRecord(&recorder, config.record_path, config, config.headless))
+        return 1;
+
+    static audio_t audio;
+    if (config.headless)
+    {
+        // headless: no window or audio device, audio optionally rendered offline to WAV
+        wav_t wav = {};
+        if (config.wav_path && !openWav(&wav, config.wav_path, config.sample_rate))
+            return 1;
+        initAudio(&audio, config.sample_rate, 0);
+
+        for (uint32_t frame = 0; chip8.state != QUIT && (!config.frames || frame < config.frames); frame++)
+        {
+            applyInputScript(&script, &chip8, frame);
+            if (netplay.connected)
+                netplayFrame(&netplay, &chip8, config, wav.file ? &audio : NULL, true);
+            else
+                emulateFrame(&chip8, config, wav.file ? &audio : NULL);
+            runAhead(&runahead, &chip8, config);
+            recordFrame(&recorder, &chip8);
+            serveFrame(&stream, &chip8);
+            if (wav.file)
+                renderWav(&wav, &audio, frameSample(&audio, audio.frames));
+        }
+
+        stopNetplay(&netplay, &chip8, config);
+        freeInputScript(&script);
+        reportRunAhead(&runahead);
+        closeWav(&wav, config.sample_rate);
+        stopRecord(&recorder);
+        stopStream(&stream);
+#ifdef DEBUG
+        stopTrace(&tracer);
+#endif
+#ifdef PROFILE
+        reportProfile(&profile, config.profile_path, 20);
+#endif
+        return 0;
+    }
+
+    // initialize sdl, audio output is opened on the first beep
+    sdl_t sdl = {0};
+    if (!initSDl(&sdl, &config))
+        std::cout << "SDL not Initialized\n";
+
+    // rewind history, one state per frame, keyframe every second; off in netplay, the peer can't follow
+    static rewind_t rewind;
+    if (netplay.connected)
+        config.rewind_seconds = 0;
+    if (config.rewind_seconds && !initRewind(&rewind, 192 * 1024, config.rewind_seconds * 60 + 1, 60))
+        std::cout << "Rewind not initialized\n";
+
  // clear screen to bg color
     clearScreen(sdl, config);
     
     // main emulator loop
+    bool first_frame = true;
+    uint32_t frame = 0; // emulated frames, for the input script
     while (chip8.state != QUIT)
     {
 
@@ -38,15 +133,56 @@ int main(int argv, char **args)
         if (chip8.state == PAUSED)
             continue;
 
-        // emulate CHIP8 instruction
-        emulateInstruction(&chip8, config);
+        // hold Backspace to rewind, one frame back per frame
+        const chip8_t *shown = &chip8;
+        if (rewind.data && SDL_GetKeyboardState(NULL)[SDL_SCANCODE_BACKSPACE])
+        {
+            rewindFrames(&rewind, &chip8, 1);
+        }
+        else
+        {
+            // emulate CHIP8 instructions for this frame, in netplay unless the peer is too far behind
+            applyInputScript(&script, &chip8, frame);
+            if (netplay.connected)
+                frame += netplayFrame(&netplay, &chip8, config, sdl.audio_dev ? &audio : NULL, false);
+            else
+            {
+                emulateFrame(&chip8, config, sdl.audio_dev ? &audio : NULL);
+                frame++;
+            }
+            startAudio(&sdl, config, &audio, &chip8);
+            if (rewind.data)
+                pushRewind(&rewind, &chip8);
+            shown = runAhead(&runahead, &chip8, config);
+        }
+
+        // updating screen, before the frame delay so the first frame isn't held back by it
+        updateScreen(sdl, config, shown);
+        recordFrame(&recorder, &chip8);
+        serveFrame(&stream, &chip8);
+        if (first_frame)
+        {
+            printf("Startup: ROM load %.1f ms, SDL init %.1f ms, window %.1f ms, renderer %.1f ms, first frame at %.1f ms\n",
+                   rom_ms, sdl.init_ms, sdl.window_ms, sdl.renderer_ms, elapsedMs(start));
+            first_frame = false;
+        }
+
         // approx 60Hz/60fps delay 16.67ms
         SDL_Delay(16);
-
-        // updating screen
-        updateScreen(sdl, config, &chip8);
     }
 
+    stopNetplay(&netplay, &chip8, config);
+    freeInputScript(&script);
+    reportRunAhead(&runahead);
+    freeRewind(&rewind);
+    stopRecord(&recorder);
+    stopStream(&stream);
     cleanUp(&sdl);
+#ifdef DEBUG
+    stopTrace(&tracer);
+#endif
+#ifdef PROFILE
+    reportProfile(&profile, config.profile_path, 20);
+#endif
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,71 @@
+#include <stdio.h>
+#include <iostream>
+
+#include "chip8_core.h"
+
+// Decode a binary instruction trace (DEBUG builds, --trace) into print_debug_info text.
+// Each record is loaded into a shadow machine holding just the operands the text shows.
+int main(int argv, char **args)
+{
+    if (argv < 2)
+    {
+        std::cerr << "Usage " << args[0] << " <trace> [--changes]\n";
+        return 1;
+    }
+    const bool changes = argv > 2 && strncmp(args[2], "--changes", strlen("--changes")) == 0;
+
+    FILE *file = fopen(args[1], "rb");
+    if (!file)
+    {
+        std::cout << "Trace " << args[1] << " invalid or does not exist!\n";
+        return 1;
+    }
+    uint8_t header[8];
+    if (fread(header, sizeof header, 1, file) != 1 || memcmp(header, "C8TR", 4) != 0 ||
+        header[4] != TRACE_VERSION || header[6] != sizeof(trace_record_t))
+    {
+        std::cout << "Not a CHIP8 trace of version " << TRACE_VERSION << "\n";
+        fclose(file);
+        return 1;
+    }
+
+    trace_record_t record;
+    while (fread(&record, sizeof record, 1, file) == 1)
+    {
+        chip8_t shadow = {};
+        shadow.PC = record.pc + 2; // fetched
+        shadow.inst.opcode = record.opcode;
+        shadow.inst.NNN = record.opcode & 0x0FFF;
+        shadow.inst.NN = record.opcode & 0x0FF;
+        shadow.inst.N = record.opcode & 0x0F;
+        shadow.inst.X = (record.opcode >> 8) & 0x0F;
+        shadow.inst.Y = (record.opcode >> 4) & 0x0F;
+        shadow.I = record.I;
+        shadow.V[0] = record.v0;
+        shadow.V[shadow.inst.Y] = record.vy;
+        shadow.V[shadow.inst.X] = record.vx;
+        shadow.delay_timer = record.delay;
+        shadow.keypad[record.vx & 0xF] = record.key;
+        shadow.stack[0] = record.ret;
+        shadow.sp = 1;
+
+        print_debug_info(&shadow);
+        if (changes && record.changed)
+        {
+            printf("  cycle %llu:", (unsigned long long)record.cycle);
+            for (uint8_t i = 0; i < 16; i++)
+                if (record.changed & (1 << i))
+                {
+                    if (i == shadow.inst.X)
+                        printf(" V%X=0x%02X", i, record.result);
+                    else if (i == 0xF)
+                        printf(" VF=0x%02X", record.flag);
+                    else
+                        printf(" V%X", i); // FX65 loads, values are in RAM
+                }
+            printf("\n");
+        }
+    }
+    fclose(file);
+    return 0;
+}